@@ -8,6 +8,7 @@
 #include <cstring>
 #include <iostream>
 #include <mutex>
+#include <new>
 #include <optional>
 
 namespace moderndbs {
@@ -315,8 +316,8 @@ struct BTree : public Segment {
                     uint64_t new_inner_page_id = next_page++;
                     BufferFrame* new_inner_page =
                         &buffer_manager.fix_page(new_inner_page_id, true);
-                    auto new_inner_node = reinterpret_cast<InnerNode*>(
-                        new_inner_page->get_data());
+                    auto new_inner_node =
+                        new (new_inner_page->get_data()) InnerNode();
                     new_inner_node->level = parent_inner_node->level;
 
                     // split the original root
@@ -327,7 +328,7 @@ struct BTree : public Segment {
                         buffer_manager.fix_page(next_page, true);
                     root = next_page++;
                     auto new_root_node =
-                        reinterpret_cast<InnerNode*>(new_root_page.get_data());
+                        new (new_root_page.get_data()) InnerNode();
                     new_root_node->level = parent_inner_node->level + 1;
                     new_root_node->first_insert(separator_key, parent_id,
                                                 new_inner_page_id);
@@ -362,8 +363,8 @@ struct BTree : public Segment {
                         uint64_t new_inner_page_id = next_page++;
                         BufferFrame* new_inner_page =
                             &buffer_manager.fix_page(new_inner_page_id, true);
-                        auto new_inner_node = reinterpret_cast<InnerNode*>(
-                            new_inner_page->get_data());
+                        auto new_inner_node =
+                            new (new_inner_page->get_data()) InnerNode();
                         new_inner_node->level = child_inner_node->level;
 
                         // split the original root
@@ -408,6 +409,9 @@ struct BTree : public Segment {
     /// @param[in] key      The key that should be searched.
     /// @return             Whether the key was in the tree.
     std::optional<ValueT> lookup(const KeyT& key) {
+        if (is_empty) {
+            return std::nullopt;
+        }
         auto [parent_page, leaf_page] = lookup_leaf_page(key, false);
         auto leaf_node = reinterpret_cast<LeafNode*>(leaf_page->get_data());
 
@@ -454,7 +458,7 @@ struct BTree : public Segment {
             root = next_page++;
             auto& root_page = buffer_manager.fix_page(root, true);
             auto root_node =
-                reinterpret_cast<BTree::LeafNode*>(root_page.get_data());
+                new (root_page.get_data()) BTree::LeafNode();
             root_node->level = 0;
             root_node->insert(key, value);
             Defer root_page_unfix(
@@ -474,7 +478,7 @@ struct BTree : public Segment {
             BufferFrame* new_leaf_page =
                 &buffer_manager.fix_page(new_leaf_page_id, true);
             LeafNode* new_leaf_node =
-                reinterpret_cast<LeafNode*>(new_leaf_page->get_data());
+                new (new_leaf_page->get_data()) LeafNode();
             new_leaf_node->level = 0;
 
             // split the original node
@@ -487,7 +491,7 @@ struct BTree : public Segment {
                     buffer_manager.fix_page(next_page, true);
 
                 InnerNode* new_root_node =
-                    reinterpret_cast<InnerNode*>(new_root_page.get_data());
+                    new (new_root_page.get_data()) InnerNode();
                 new_root_node->level = 1;
                 new_root_node->first_insert(separator_key, root,
                                             new_leaf_page_id);
@@ -9,8 +9,23 @@
 #include <shared_mutex>
 #include <mutex>
 
+#ifdef MODERNDBS_MMAP_BUFFER_MANAGER
+#include "moderndbs/mmap_buffer_manager.h"
+#endif
+
 namespace moderndbs {
 
+#ifdef MODERNDBS_MMAP_BUFFER_MANAGER
+
+// Built with MODERNDBS_MMAP_BUFFER_MANAGER, the B-tree runs on the mmap-based
+// buffer manager of the buffer-manager project instead of the dummy below.
+// The buffer pool of that project needs no aliases, with
+// MODERNDBS_BUFFER_MANAGER=pool its buffer_manager.h is found before this one.
+using BufferFrame = MmapBufferFrame;
+using BufferManager = MmapBufferManager;
+
+#else
+
 class BufferFrame {
    private:
    friend class BufferManager;
@@ -87,6 +102,8 @@ class BufferManager {
    }
 };
 
+#endif
+
 } // namespace moderndbs
 
 #endif
@@ -17,9 +17,24 @@ set(
 
 set(
     SRC_CC
-    src/buffer_manager.cc
     src/hex_dump.cc
 )
+if(MODERNDBS_BUFFER_MANAGER STREQUAL "pool")
+    list(
+        APPEND SRC_CC ../buffer-manager/src/buffer_manager.cc
+        ../buffer-manager/src/log_manager.cc ../buffer-manager/src/numa.cc
+        ../buffer-manager/src/page_guard.cc ../buffer-manager/src/page_table.cc
+        ../buffer-manager/src/replacement_policy.cc
+        ../buffer-manager/src/scan_cursor.cc
+        ../buffer-manager/src/segment_file_cache.cc
+        ../buffer-manager/src/file/posix_file.cc
+        ../buffer-manager/src/file/io_uring.cc
+    )
+elseif(MODERNDBS_BUFFER_MANAGER STREQUAL "mmap")
+    list(APPEND SRC_CC ../buffer-manager/src/mmap_buffer_manager.cc)
+else()
+    list(APPEND SRC_CC src/buffer_manager.cc)
+endif()
 
 # Gather lintable files
 set(SRC_CC_LINTING "")
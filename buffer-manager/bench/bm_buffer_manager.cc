@@ -3,19 +3,35 @@
 // ---------------------------------------------------------------------------------------------------
 #include "benchmark/benchmark.h"
 #include "moderndbs/buffer_manager.h"
+#include "moderndbs/file.h"
+#include "moderndbs/log_manager.h"
+#include "moderndbs/mmap_buffer_manager.h"
+#include "moderndbs/numa.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include <random>
+#include <sched.h>
 #include <thread>
+#include <type_traits>
 #include <vector>
 // ---------------------------------------------------------------------------------------------------
 
 namespace {
 
 void BufferManager_Multi(benchmark::State& state) {
+   const auto thread_count = static_cast<size_t>(state.range(0));
+   const auto page_count = static_cast<size_t>(state.range(1));
+   moderndbs::BufferManagerOptions options;
+   options.partition_count = static_cast<size_t>(state.range(2));
+   const auto accesses_per_thread = static_cast<size_t>(state.range(3));
+   // The pool stays warm across iterations, so with enough pages the
+   // workload is dominated by hits.
+   moderndbs::BufferManager buffer_manager{1024, page_count, options};
    for (auto _ : state) {
-      moderndbs::BufferManager buffer_manager{1024, 10};
       std::vector<std::thread> threads;
-      for (size_t i = 0; i < 10; ++i) {
-         threads.emplace_back([i, &buffer_manager] {
+      for (size_t i = 0; i < thread_count; ++i) {
+         threads.emplace_back([i, accesses_per_thread, &buffer_manager] {
             std::mt19937_64 engine{i};
             // 70% reads, 30% writes
             std::bernoulli_distribution reads_distr{0.7};
@@ -25,18 +41,425 @@ void BufferManager_Multi(benchmark::State& state) {
             std::uniform_int_distribution<uint64_t> segment_distr{0, 4};
             // with a hundred pages each
             std::uniform_int_distribution<uint16_t> page_distr{0, 99};
-            for (size_t j = 0; j < 500; ++j) {
+            for (size_t j = 0; j < accesses_per_thread; ++j) {
                uint64_t page_id = (static_cast<uint64_t>(segment_distr(engine)) << 48) | page_distr(engine);
                bool write_access = !reads_distr(engine);
-               while (true) {
-                  try {
-                     auto& page = buffer_manager.fix_page(page_id, write_access);
-                     auto tmp = *(page.get_data() + distr(engine) - 1);
-                     benchmark::DoNotOptimize(tmp);
-                     buffer_manager.unfix_page(page, write_access);
-                     break;
-                  } catch (const moderndbs::buffer_full_error&) {}
+               // wait for a frame instead of retrying on buffer_full_error
+               auto* page = buffer_manager.fix_page_wait(page_id, write_access ? moderndbs::AccessMode::Exclusive : moderndbs::AccessMode::Shared);
+               auto tmp = *(page->get_data() + distr(engine) - 1);
+               benchmark::DoNotOptimize(tmp);
+               buffer_manager.unfix_page(*page, write_access);
+            }
+         });
+      }
+      for (auto& thread : threads) {
+         thread.join();
+      }
+   }
+   state.SetItemsProcessed(state.iterations() * thread_count * accesses_per_thread);
+}
+
+/// Thread-count sweep for a hit-dominated workload: all 500 pages fit into
+/// the pool, once with a single partition and once with 64 partitions.
+void MultiThreadSweep(benchmark::internal::Benchmark* benchmark) {
+   for (int64_t partitions : {1, 64}) {
+      for (int64_t threads = 1; threads <= 64; threads *= 2) {
+         benchmark->Args({threads, 1000, partitions, 20000});
+      }
+   }
+}
+
+void BufferManager_FixHit(benchmark::State& state) {
+   const auto page_count = static_cast<size_t>(state.range(0));
+   // Small pages keep the pool and the segment file small, the page size does
+   // not matter for the bookkeeping on a hit.
+   moderndbs::BufferManager buffer_manager{64, page_count};
+   // Load every page so that every fix below is a hit. Nothing is evicted,
+   // so all pages stay in the FIFO list, where hits do not move them.
+   for (uint64_t page_id = 0; page_id < page_count; ++page_id) {
+      auto& page = buffer_manager.fix_page(page_id, false);
+      buffer_manager.unfix_page(page, false);
+   }
+   std::mt19937_64 engine{0};
+   std::uniform_int_distribution<uint64_t> page_distr{0, page_count - 1};
+   for (auto _ : state) {
+      auto& page = buffer_manager.fix_page(page_distr(engine), false);
+      benchmark::DoNotOptimize(page.get_data());
+      buffer_manager.unfix_page(page, false);
+   }
+   state.SetItemsProcessed(state.iterations());
+}
+
+void BufferManager_FixMiss(benchmark::State& state) {
+   moderndbs::BufferManagerOptions options;
+   options.max_open_files = static_cast<size_t>(state.range(0));
+   // 16 frames for 10000 pages spread over 4 segments, so nearly every fix
+   // is a miss on a clean victim and costs exactly one read.
+   moderndbs::BufferManager buffer_manager{1024, 16, options};
+   std::mt19937_64 engine{0};
+   std::uniform_int_distribution<uint64_t> segment_distr{0, 3};
+   std::uniform_int_distribution<uint64_t> page_distr{0, 2499};
+   for (auto _ : state) {
+      uint64_t page_id = (segment_distr(engine) << 48) | page_distr(engine);
+      auto& page = buffer_manager.fix_page(page_id, false);
+      benchmark::DoNotOptimize(page.get_data());
+      buffer_manager.unfix_page(page, false);
+   }
+   state.SetItemsProcessed(state.iterations());
+}
+
+void BufferManager_WriteHeavy(benchmark::State& state) {
+   moderndbs::BufferManagerOptions options;
+   options.io_mode = static_cast<moderndbs::File::IOMode>(state.range(0));
+   // 64 frames for 1024 pages of 4 KiB, 90% of the fixes modify the page and
+   // every 256 fixes the batch is made durable.
+   moderndbs::BufferManager buffer_manager{4096, 64, options};
+   std::mt19937_64 engine{0};
+   std::bernoulli_distribution writes_distr{0.9};
+   std::uniform_int_distribution<uint64_t> page_distr{0, 1023};
+   size_t fixes = 0;
+   for (auto _ : state) {
+      bool write_access = writes_distr(engine);
+      auto& page = buffer_manager.fix_page(page_distr(engine), write_access);
+      if (write_access) {
+         ++*reinterpret_cast<uint64_t*>(page.get_data());
+      }
+      buffer_manager.unfix_page(page, write_access);
+      if (++fixes % 256 == 0) {
+         buffer_manager.flush_all();
+      }
+   }
+   state.SetItemsProcessed(state.iterations());
+}
+
+enum class Workload { Uniform, Zipf, ScanMixed };
+
+/// Returns a trace of `length` page ids in segment 10 with `page_count`
+/// distinct pages.
+std::vector<uint64_t> make_trace(Workload workload, size_t page_count, size_t length) {
+   std::mt19937_64 engine{42};
+   std::uniform_int_distribution<uint64_t> uniform_distr{0, page_count - 1};
+   // Zipf with s = 0.99 via the inverse of the cumulative distribution
+   std::vector<double> cdf(page_count);
+   double sum = 0;
+   for (size_t i = 0; i < page_count; ++i) {
+      sum += 1.0 / std::pow(static_cast<double>(i + 1), 0.99);
+      cdf[i] = sum;
+   }
+   std::uniform_real_distribution<double> zipf_distr{0, sum};
+   auto zipf = [&] {
+      auto rank = static_cast<uint64_t>(std::lower_bound(cdf.begin(), cdf.end(), zipf_distr(engine)) - cdf.begin());
+      // scatter the hot pages over the segment
+      return std::min<uint64_t>(rank, page_count - 1) * 7919 % page_count;
+   };
+   std::vector<uint64_t> trace;
+   trace.reserve(length);
+   uint64_t scan_position = 0;
+   for (size_t i = 0; i < length; ++i) {
+      uint64_t page_id = 0;
+      switch (workload) {
+         case Workload::Uniform: page_id = uniform_distr(engine); break;
+         case Workload::Zipf: page_id = zipf(); break;
+         case Workload::ScanMixed:
+            // every fourth access continues a sequential scan over all pages
+            page_id = i % 4 == 3 ? scan_position++ % page_count : zipf();
+            break;
+      }
+      trace.push_back((uint64_t{10} << 48) | page_id);
+   }
+   return trace;
+}
+
+void BufferManager_Trace(benchmark::State& state) {
+   constexpr size_t page_count = 10000;
+   moderndbs::BufferManagerOptions options;
+   options.replacement = static_cast<moderndbs::ReplacementStrategy>(state.range(0));
+   auto trace = make_trace(static_cast<Workload>(state.range(1)), page_count, 1 << 16);
+   // the pool holds 10% of the pages, small pages keep the segment file small
+   moderndbs::BufferManager buffer_manager{64, page_count / 10, options};
+   auto replay = [&](size_t i) {
+      auto& page = buffer_manager.fix_page(trace[i % trace.size()], false);
+      benchmark::DoNotOptimize(page.get_data());
+      buffer_manager.unfix_page(page, false);
+   };
+   for (size_t i = 0; i < trace.size(); ++i) {
+      replay(i);
+   }
+   auto hits = buffer_manager.get_hit_count();
+   auto misses = buffer_manager.get_miss_count();
+   size_t i = 0;
+   for (auto _ : state) {
+      replay(i++);
+   }
+   hits = buffer_manager.get_hit_count() - hits;
+   misses = buffer_manager.get_miss_count() - misses;
+   state.counters["hit_ratio"] = static_cast<double>(hits) / static_cast<double>(std::max<size_t>(hits + misses, 1));
+   state.SetItemsProcessed(state.iterations());
+}
+void BufferManager_PolicyHit(benchmark::State& state) {
+   // random hits on 1000 resident pages, which update the replacement state of 2Q and LRU-K but only read a bit
+   // with CLOCK and the cooling stage
+   constexpr size_t page_count = 1000;
+   moderndbs::BufferManagerOptions options;
+   options.replacement = static_cast<moderndbs::ReplacementStrategy>(state.range(0));
+   moderndbs::BufferManager buffer_manager{64, page_count, options};
+   for (size_t round = 0; round < 2; ++round) {
+      for (uint64_t page_id = 0; page_id < page_count; ++page_id) {
+         buffer_manager.unfix_page(buffer_manager.fix_page(page_id, false), false);
+      }
+   }
+   std::mt19937_64 engine{0};
+   std::uniform_int_distribution<uint64_t> page_distr{0, page_count - 1};
+   for (auto _ : state) {
+      auto& page = buffer_manager.fix_page(page_distr(engine), false);
+      benchmark::DoNotOptimize(page.get_data());
+      buffer_manager.unfix_page(page, false);
+   }
+   state.SetItemsProcessed(state.iterations());
+}
+
+void BufferManager_SequentialScan(benchmark::State& state) {
+   // 4096 pages of 4 KiB in segment 14 against a pool of 256 frames, read
+   // with direct I/O so that every miss pays for the device
+   constexpr size_t page_size = 4096;
+   constexpr uint64_t segment_pages = 4096;
+   {
+      // write the pages instead of resizing the file, reads of holes in a
+      // sparse file do not reach the device
+      auto file = moderndbs::File::open_file("14", moderndbs::File::WRITE);
+      if (file->size() < segment_pages * page_size) {
+         std::vector<char> block(256 * page_size, 1);
+         for (uint64_t offset = 0; offset < segment_pages * page_size; offset += block.size()) {
+            file->write_block(block.data(), offset, block.size());
+         }
+      }
+   }
+   moderndbs::BufferManagerOptions options;
+   options.io_mode = moderndbs::File::DIRECT;
+   options.max_read_ahead = static_cast<size_t>(state.range(0));
+   moderndbs::BufferManager buffer_manager{page_size, 256, options};
+   uint64_t page = 0;
+   for (auto _ : state) {
+      auto& frame = buffer_manager.fix_page((uint64_t{14} << 48) | page, false);
+      benchmark::DoNotOptimize(frame.get_data());
+      buffer_manager.unfix_page(frame, false);
+      page = (page + 1) % segment_pages;
+   }
+   auto stats = buffer_manager.get_prefetch_stats();
+   state.counters["issued"] = static_cast<double>(stats.issued);
+   state.counters["used"] = static_cast<double>(stats.used);
+   state.counters["wasted"] = static_cast<double>(stats.wasted);
+   state.SetItemsProcessed(state.iterations());
+}
+
+void BufferManager_FlushDirty(benchmark::State& state) {
+   // 1024 dirty pages of 4 KiB in segment 18 that are all resident, written
+   // back by flush_all() with one write per page or combined writes
+   constexpr size_t page_size = 4096;
+   constexpr uint64_t page_count = 1024;
+   moderndbs::BufferManagerOptions options;
+   options.io_mode = static_cast<moderndbs::File::IOMode>(state.range(0));
+   options.max_write_pages = static_cast<size_t>(state.range(1));
+   moderndbs::BufferManager buffer_manager{page_size, page_count, options};
+   for (auto _ : state) {
+      for (uint64_t page = 0; page < page_count; ++page) {
+         auto& frame = buffer_manager.fix_page((uint64_t{18} << 48) | page, true);
+         ++*reinterpret_cast<uint64_t*>(frame.get_data());
+         buffer_manager.unfix_page(frame, true);
+      }
+      buffer_manager.flush_all();
+   }
+   auto stats = buffer_manager.stats();
+   state.counters["write_requests"] = benchmark::Counter(static_cast<double>(stats.write_requests), benchmark::Counter::kAvgIterations);
+   state.SetBytesProcessed(state.iterations() * page_count * page_size);
+}
+
+void BufferManager_Commit(benchmark::State& state) {
+   // every thread repeatedly commits updates of 4 of its own pages in
+   // segment 21, either by writing the dirty pages with O_SYNC (0) or by
+   // flushing the write-ahead log (1)
+   const auto thread_count = static_cast<size_t>(state.range(0));
+   const bool use_log = state.range(1) != 0;
+   constexpr size_t commits_per_thread = 64;
+   constexpr uint64_t pages_per_commit = 4;
+   std::remove("bench_commit.log");
+   moderndbs::LogManager log{"bench_commit.log"};
+   moderndbs::BufferManagerOptions options;
+   options.io_mode = use_log ? moderndbs::File::BUFFERED : moderndbs::File::SYNC;
+   options.log = use_log ? &log : nullptr;
+   moderndbs::BufferManager buffer_manager{4096, 64, options};
+   auto flushes = log.get_flush_count();
+   for (auto _ : state) {
+      std::vector<std::thread> threads;
+      for (size_t i = 0; i < thread_count; ++i) {
+         threads.emplace_back([&, i] {
+            for (size_t j = 0; j < commits_per_thread; ++j) {
+               uint64_t lsn = 0;
+               for (uint64_t k = 0; k < pages_per_commit; ++k) {
+                  auto& page = buffer_manager.fix_page((uint64_t{21} << 48) | (i * 8 + k * 2), true);
+                  ++*reinterpret_cast<uint64_t*>(page.get_data());
+                  if (use_log) {
+                     lsn = buffer_manager.log_update(page, 0, sizeof(uint64_t));
+                  }
+                  buffer_manager.unfix_page(page, true);
+               }
+               if (use_log) {
+                  log.flush(lsn);
+               } else {
+                  buffer_manager.flush_all();
+               }
+            }
+         });
+      }
+      for (auto& thread : threads) {
+         thread.join();
+      }
+   }
+   auto commits = state.iterations() * thread_count * commits_per_thread;
+   state.counters["log_syncs_per_commit"] = static_cast<double>(log.get_flush_count() - flushes) / static_cast<double>(commits);
+   state.SetItemsProcessed(commits);
+}
+
+void BufferManager_NumaHit(benchmark::State& state) {
+   // 256 pages of 4 KiB in segment 22 are loaded by a thread pinned to node 0, so they land in frames on node 0,
+   // and are then read completely by the same thread pinned to node 0 (local) or to the last node (remote)
+   const auto& topology = moderndbs::NumaTopology::get();
+   const bool remote = state.range(0) != 0;
+   if (remote && topology.node_count() < 2) {
+      state.SkipWithError("needs at least two NUMA nodes");
+      return;
+   }
+   constexpr size_t page_size = 4096;
+   constexpr uint64_t page_count = 256;
+   cpu_set_t affinity;
+   sched_getaffinity(0, sizeof(affinity), &affinity);
+   topology.pin_thread(0);
+   moderndbs::BufferManagerOptions options;
+   options.numa_aware = true;
+   moderndbs::BufferManager buffer_manager{page_size, 4 * page_count, options};
+   for (uint64_t page = 0; page < page_count; ++page) {
+      auto& frame = buffer_manager.fix_page((uint64_t{22} << 48) | page, true);
+      std::fill_n(frame.get_data(), page_size, static_cast<char>(page));
+      buffer_manager.unfix_page(frame, true);
+   }
+   topology.pin_thread(remote ? static_cast<unsigned>(topology.node_count() - 1) : 0);
+   uint64_t page = 0;
+   for (auto _ : state) {
+      auto& frame = buffer_manager.fix_page((uint64_t{22} << 48) | page, false);
+      const auto* data = reinterpret_cast<const uint64_t*>(frame.get_data());
+      uint64_t sum = 0;
+      for (size_t i = 0; i < page_size / sizeof(uint64_t); ++i) {
+         sum += data[i];
+      }
+      benchmark::DoNotOptimize(sum);
+      buffer_manager.unfix_page(frame, false);
+      page = (page + 1) % page_count;
+   }
+   sched_setaffinity(0, sizeof(affinity), &affinity);
+   state.SetBytesProcessed(state.iterations() * page_size);
+}
+
+void BufferManager_HugePageHit(benchmark::State& state) {
+   // 512 MiB of resident 4 KiB pages in segment 24, read at a random offset by every fix, with the pool mapped with
+   // 4 KiB pages (0) or with huge pages (1)
+   constexpr size_t page_size = 4096;
+   constexpr uint64_t page_count = 128 * 1024;
+   moderndbs::BufferManagerOptions options;
+   options.huge_pages = state.range(0) != 0;
+   options.io_mode = moderndbs::File::BUFFERED;
+   moderndbs::BufferManager buffer_manager{page_size, page_count, options};
+   for (uint64_t page = 0; page < page_count; ++page) {
+      auto& frame = buffer_manager.fix_page((uint64_t{24} << 48) | page, false);
+      buffer_manager.unfix_page(frame, false);
+   }
+   std::mt19937_64 engine{0};
+   std::uniform_int_distribution<uint64_t> page_distr{0, page_count - 1};
+   std::uniform_int_distribution<size_t> offset_distr{0, page_size / sizeof(uint64_t) - 1};
+   for (auto _ : state) {
+      auto& frame = buffer_manager.fix_page((uint64_t{24} << 48) | page_distr(engine), false);
+      benchmark::DoNotOptimize(reinterpret_cast<const uint64_t*>(frame.get_data())[offset_distr(engine)]);
+      buffer_manager.unfix_page(frame, false);
+   }
+   state.counters["pool_page_size"] = static_cast<double>(buffer_manager.get_pool_page_size());
+   state.SetItemsProcessed(state.iterations());
+}
+
+void BufferManager_FixBatch(benchmark::State& state) {
+   // probes of 64 random pages of segment 26 that are fixed one by one (0) or with fix_pages() (1). With resident=1
+   // the segment is half the size of the pool, so that every partition can hold its share and all probes are hits.
+   // With resident=0 it is 16 times the size of the pool, so that most probes are read with direct I/O.
+   const bool batch = state.range(0) != 0;
+   const bool resident = state.range(1) != 0;
+   constexpr size_t probe_size = 64;
+   constexpr uint64_t pool_pages = 1024;
+   const uint64_t segment_pages = resident ? pool_pages / 2 : 16 * pool_pages;
+   moderndbs::BufferManagerOptions options;
+   options.partition_count = 8;
+   options.io_mode = moderndbs::File::DIRECT;
+   moderndbs::BufferManager buffer_manager{4096, pool_pages, options};
+   for (uint64_t page = 0; page < segment_pages; ++page) {
+      auto& frame = buffer_manager.fix_page((uint64_t{26} << 48) | page, true);
+      buffer_manager.unfix_page(frame, true);
+   }
+   buffer_manager.flush_all();
+   std::mt19937_64 engine{0};
+   std::uniform_int_distribution<uint64_t> page_distr{0, segment_pages - 1};
+   std::vector<uint64_t> page_ids(probe_size);
+   std::vector<moderndbs::BufferFrame*> frames(probe_size);
+   for (auto _ : state) {
+      for (auto& page_id : page_ids) {
+         page_id = (uint64_t{26} << 48) | page_distr(engine);
+      }
+      if (batch) {
+         frames = buffer_manager.fix_pages(page_ids, moderndbs::AccessMode::Shared);
+         buffer_manager.unfix_pages(frames, false);
+      } else {
+         for (auto page_id : page_ids) {
+            auto& frame = buffer_manager.fix_page(page_id, false);
+            benchmark::DoNotOptimize(frame.get_data());
+            buffer_manager.unfix_page(frame, false);
+         }
+      }
+   }
+   state.SetItemsProcessed(state.iterations() * probe_size);
+}
+
+template <typename Manager>
+void BufferManager_PoolVsMmap(benchmark::State& state) {
+   // random fixes of 4 KiB pages of segment 28, every tenth one exclusive and dirty, on a pool of 64 MiB. With
+   // the mmap-based manager the same pages are cached by the kernel instead, which always has room for them.
+   const auto segment_pages = static_cast<uint64_t>(state.range(0));
+   const auto thread_count = static_cast<size_t>(state.range(1));
+   constexpr size_t pool_pages = 16384;
+   constexpr size_t accesses_per_thread = 10000;
+   std::unique_ptr<Manager> buffer_manager;
+   if constexpr (std::is_same_v<Manager, moderndbs::BufferManager>) {
+      moderndbs::BufferManagerOptions options;
+      options.partition_count = 8;
+      options.io_mode = moderndbs::File::BUFFERED;
+      buffer_manager = std::make_unique<Manager>(4096, pool_pages, options);
+   } else {
+      buffer_manager = std::make_unique<Manager>(4096, pool_pages);
+   }
+   for (uint64_t page = 0; page < segment_pages; ++page) {
+      auto& frame = buffer_manager->fix_page((uint64_t{28} << 48) | page, true);
+      *reinterpret_cast<uint64_t*>(frame.get_data()) = page;
+      buffer_manager->unfix_page(frame, true);
+   }
+   for (auto _ : state) {
+      std::vector<std::thread> threads;
+      for (size_t thread = 0; thread < thread_count; ++thread) {
+         threads.emplace_back([&, thread] {
+            std::mt19937_64 engine{thread};
+            std::uniform_int_distribution<uint64_t> page_distr{0, segment_pages - 1};
+            for (size_t access = 0; access < accesses_per_thread; ++access) {
+               const bool exclusive = access % 10 == 0;
+               auto& frame = buffer_manager->fix_page((uint64_t{28} << 48) | page_distr(engine), exclusive);
+               if (exclusive) {
+                  ++*reinterpret_cast<uint64_t*>(frame.get_data());
                }
+               benchmark::DoNotOptimize(frame.get_data());
+               buffer_manager->unfix_page(frame, exclusive);
             }
          });
       }
@@ -44,7 +467,39 @@ void BufferManager_Multi(benchmark::State& state) {
          thread.join();
       }
    }
+   state.SetItemsProcessed(state.iterations() * thread_count * accesses_per_thread);
 }
 } // namespace
 
-BENCHMARK(BufferManager_Multi)->UseRealTime()->MinTime(10);
+BENCHMARK(BufferManager_Multi)->ArgNames({"threads", "pages", "partitions", "accesses"})->UseRealTime()->MinTime(10)->Args({10, 10, 1, 500});
+BENCHMARK(BufferManager_Multi)->ArgNames({"threads", "pages", "partitions", "accesses"})->UseRealTime()->Apply(MultiThreadSweep);
+// Hit latency must not depend on the number of frames in the pool.
+BENCHMARK(BufferManager_FixHit)->RangeMultiplier(10)->Range(10, 1000000)->Unit(benchmark::kNanosecond);
+// Miss latency without (0) and with a cache of open segment files.
+BENCHMARK(BufferManager_FixMiss)->ArgName("max_open_files")->Arg(0)->Arg(64)->Unit(benchmark::kMicrosecond);
+// Write-heavy mix with O_SYNC (0), buffered (1) and direct (2) segment files.
+BENCHMARK(BufferManager_WriteHeavy)->ArgName("io_mode")->DenseRange(moderndbs::File::SYNC, moderndbs::File::DIRECT)->Unit(benchmark::kMicrosecond);
+// Hit ratio and fix latency of the replacement policies (2Q, CLOCK, LRU-2,
+// cooling) on uniform (0), Zipf (1) and Zipf mixed with a sequential scan (2)
+// traces.
+BENCHMARK(BufferManager_Trace)->ArgNames({"policy", "workload"})->ArgsProduct({{0, 1, 2, 3}, {0, 1, 2}})->Unit(benchmark::kNanosecond);
+// Hit latency of the replacement policies (2Q, CLOCK, LRU-2, cooling).
+BENCHMARK(BufferManager_PolicyHit)->ArgName("policy")->DenseRange(0, 3)->Unit(benchmark::kNanosecond);
+// Sequential scan over a segment larger than the pool without (0) and with
+// automatic read-ahead of up to 64 pages.
+BENCHMARK(BufferManager_SequentialScan)->ArgName("max_read_ahead")->Arg(0)->Arg(64)->Unit(benchmark::kMicrosecond);
+// flush_all() of 4 MiB of adjacent dirty pages, buffered (1) and direct (2),
+// with one write per page and with up to 32 pages per vectored write.
+BENCHMARK(BufferManager_FlushDirty)->ArgNames({"io_mode", "max_write_pages"})->ArgsProduct({{moderndbs::File::BUFFERED, moderndbs::File::DIRECT}, {1, 32}})->UseRealTime()->Unit(benchmark::kMillisecond);
+// Commit throughput with page writes (0) and with the write-ahead log (1).
+BENCHMARK(BufferManager_Commit)->ArgNames({"threads", "log"})->ArgsProduct({{1, 8}, {0, 1}})->UseRealTime()->Unit(benchmark::kMillisecond);
+// Hit latency of pages on the local (0) and on a remote NUMA node (1).
+BENCHMARK(BufferManager_NumaHit)->ArgName("remote")->Arg(0)->Arg(1)->Unit(benchmark::kNanosecond);
+// Random hits in a 512 MiB pool mapped with 4 KiB pages (0) and huge pages (1).
+BENCHMARK(BufferManager_HugePageHit)->ArgName("huge_pages")->Arg(0)->Arg(1)->Unit(benchmark::kNanosecond);
+// Probes of 64 pages fixed one by one (0) and as a batch (1), missed (0) or resident (1).
+BENCHMARK(BufferManager_FixBatch)->ArgNames({"batch", "resident"})->ArgsProduct({{0, 1}, {0, 1}})->UseRealTime()->Unit(benchmark::kMicrosecond);
+// The buffer pool against the kernel's page cache, on data that fits into the pool (8192 pages) and on data
+// four times larger (65536 pages).
+BENCHMARK_TEMPLATE(BufferManager_PoolVsMmap, moderndbs::BufferManager)->ArgNames({"pages", "threads"})->ArgsProduct({{8192, 65536}, {1, 4}})->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BufferManager_PoolVsMmap, moderndbs::MmapBufferManager)->ArgNames({"pages", "threads"})->ArgsProduct({{8192, 65536}, {1, 4}})->UseRealTime()->Unit(benchmark::kMillisecond);
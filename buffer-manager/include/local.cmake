@@ -9,4 +9,9 @@
 set(
     INCLUDE_H
     include/moderndbs/buffer_manager.h include/moderndbs/file.h
+    include/moderndbs/io_uring.h include/moderndbs/log_manager.h
+    include/moderndbs/mmap_buffer_manager.h include/moderndbs/numa.h
+    include/moderndbs/page_guard.h include/moderndbs/page_table.h
+    include/moderndbs/replacement_policy.h include/moderndbs/scan_cursor.h
+    include/moderndbs/segment_file_cache.h
 )
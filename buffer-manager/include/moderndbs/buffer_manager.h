@@ -1,60 +1,234 @@
 #ifndef INCLUDE_MODERNDBS_BUFFER_MANAGER_H
 #define INCLUDE_MODERNDBS_BUFFER_MANAGER_H
 
+#include "moderndbs/file.h"
+#include "moderndbs/log_manager.h"
+#include "moderndbs/page_table.h"
+#include "moderndbs/replacement_policy.h"
+#include "moderndbs/segment_file_cache.h"
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
-#include <deque>
 #include <exception>
 #include <iostream>
+#include <limits>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <shared_mutex>
+#include <span>
+#include <thread>
 #include <tuple>
-#include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace moderndbs {
 
-class BufferFrame {
+/// Read/write latch of a buffer frame that can be upgraded in place. A
+/// holder of the shared latch announces the upgrade, which keeps new readers
+/// and writers out, and waits until the other readers left. Only one thread
+/// can announce an upgrade at a time, because two upgraders would wait for
+/// each other's shared latch.
+class FrameLatch {
+  private:
+    // set while the latch is held exclusively
+    static constexpr uint32_t exclusive = uint32_t{1} << 31;
+    // set while a shared holder waits for the other readers to upgrade
+    static constexpr uint32_t upgrading = uint32_t{1} << 30;
+    // set if a thread sleeps on the latch and has to be woken up
+    static constexpr uint32_t waiting = uint32_t{1} << 29;
+    // number of shared holders
+    static constexpr uint32_t readers = waiting - 1;
+
+    std::atomic<uint32_t> state = 0;
+
+    /// Sleeps until the latch changes from `current`.
+    void wait(uint32_t current);
+
+  public:
+    void lock_shared();
+    bool try_lock_shared();
+    void unlock_shared();
+    void lock();
+    bool try_lock();
+    void unlock();
+
+    /// Turns the shared latch of the caller into the exclusive latch without
+    /// releasing it. Returns false and keeps the shared latch if another
+    /// thread is upgrading already.
+    bool try_upgrade();
+
+    /// Turns the exclusive latch of the caller into a shared latch without
+    /// releasing it.
+    void downgrade();
+};
+
+/// Descriptor of a frame of the buffer pool. The descriptors of a partition
+/// are allocated once and every one owns a fixed slot of the pool memory,
+/// so they never move while the pool exists. Aligned to a cache line so that
+/// fixes of different frames do not contend on the same line.
+class alignas(64) BufferFrame {
   private:
     friend class BufferManager;
+    friend class FrameList;
+    friend class TwoQPolicy;
+    friend class ClockPolicy;
+    friend class LruKPolicy;
+    friend class CoolingPolicy;
 
     // state of the current frame state
     enum State { CLEAN, DIRTY, NEW };
 
     // positon of the current frame
-    enum Position { NONE, FIFO, LRU };
+    enum Position { NONE, FIFO, LRU, HOT, COOLING };
 
-    // the page id
-    uint64_t page_id;
+    // `thread_cnt` of a frame that is being assigned to a page under the
+    // partition latch, it cannot be fixed until the assignment is finished
+    static constexpr size_t unpinnable = std::numeric_limits<size_t>::max();
 
-    // how many threads are using the frame
-    size_t thread_cnt = 0;
+    // the page id, only meaningful while the frame is in the page table.
+    // Only changes while the frame is unpinnable. Atomic because optimistic
+    // readers and scan rings check it without pinning the frame.
+    std::atomic<uint64_t> page_id = 0;
 
-    size_t start_pos = 0;
+    // how many threads are using the frame, a frame with a non-zero count is
+    // never evicted. Frames that have never held a page are unpinnable.
+    std::atomic<size_t> thread_cnt = unpinnable;
 
     // a read/write lock to protect the page
-    std::shared_timed_mutex frame_latch;
+    FrameLatch frame_latch;
+
+    // incremented whenever the frame is latched and unlatched exclusively,
+    // when its page is evicted and when a new page was read into it, so it
+    // is odd while a writer holds the frame or its page is replaced.
+    // Optimistic readers validate against it instead of taking the latch.
+    std::atomic<uint64_t> version = 0;
 
-    // state of the buffer frame
-    State state = NEW;
+    // set while an asynchronous read of the page is in flight, fixes wait
+    // for it to be cleared before they return the frame
+    std::atomic<bool> io_pending = false;
 
+    // set if the read of the page failed while other threads waited for it,
+    // the first of them reads the page again
+    std::atomic<bool> read_failed = false;
+
+    // set while a checkpoint writes a copy of the page, the cleaner and
+    // `flush_all()` wait for it before they write the page themselves, so
+    // that the older copy cannot overwrite their write
+    std::atomic<bool> writing = false;
+
+    // set if the page was prefetched and not fixed since
+    std::atomic<bool> prefetched = false;
+
+    // LSN of the last logged modification of the page, the page must not
+    // be written before the log is flushed up to it
+    std::atomic<uint64_t> page_lsn = 0;
+
+    // state of the buffer frame, shared holders may mark the frame dirty
+    // concurrently
+    std::atomic<State> state = NEW;
+
+    // list of the 2Q policy or set of the cooling policy the frame is in
     Position position = NONE;
 
+    // index of the frame in the hot set of the cooling policy
+    size_t hot_slot = 0;
+
+    // reference bit of the CLOCK and cooling policies, set without the
+    // partition latch
+    std::atomic<bool> referenced = false;
+
+    // neighbours in the replacement policy's list the frame is linked into
+    BufferFrame* prev = nullptr;
+    BufferFrame* next = nullptr;
+
     // the actual data contained on the page
-    char* data;
+    char* data = nullptr;
+
+    /// Increments the fix count unless the frame is unpinnable. Does not need
+    /// the partition latch.
+    bool try_pin();
+
+    /// Makes an unfixed frame unpinnable, so that it can be evicted. Must be
+    /// called with the partition latch held.
+    bool try_claim();
 
   public:
     /// Returns a pointer to this page's data.
     char* get_data();
+    const char* get_data() const;
+
+    /// Starts an optimistic read of a frame that was fixed with
+    /// `AccessMode::Optimistic` and returns the version to validate against.
+    /// Waits while the frame is latched exclusively.
+    [[nodiscard]] uint64_t read_version() const;
+
+    /// Returns true if the frame was not latched exclusively since
+    /// `read_version()` returned `version`, i.e. if everything read from the
+    /// page in between is consistent. Otherwise the read has to be restarted.
+    [[nodiscard]] bool validate(uint64_t version) const;
 
     BufferFrame();
     BufferFrame(uint64_t page_id, char* data);
 };
 
+/// Intrusive doubly-linked list of buffer frames used by the replacement
+/// policies.
+/// Frames are linked through their own `prev`/`next` pointers, so appending,
+/// unlinking and moving a frame are constant time. The list does not own the
+/// frames and is not thread-safe.
+class FrameList {
+  private:
+    BufferFrame* head = nullptr;
+    BufferFrame* tail = nullptr;
+    size_t length = 0;
+
+  public:
+    /// Returns the first (oldest) frame or nullptr if the list is empty.
+    [[nodiscard]] BufferFrame* front() const { return head; }
+
+    /// Returns the frame following `frame` or nullptr at the end of the list.
+    [[nodiscard]] static BufferFrame* next(const BufferFrame* frame) {
+        return frame->next;
+    }
+
+    [[nodiscard]] size_t size() const { return length; }
+    [[nodiscard]] bool empty() const { return length == 0; }
+
+    /// Appends `frame` which must not be linked into any list.
+    void push_back(BufferFrame* frame);
+
+    /// Links `frame` which must not be linked into any list in front of
+    /// `position` which must be linked into this list.
+    void insert_before(BufferFrame* position, BufferFrame* frame);
+
+    /// Unlinks `frame` which must be linked into this list.
+    void remove(BufferFrame* frame);
+
+    /// Moves `frame` which must be linked into this list to its end.
+    void move_to_back(BufferFrame* frame);
+};
+
+/// How a fixed page is latched.
+enum class AccessMode {
+    /// Shared latch, several readers may hold the page at the same time.
+    Shared,
+    /// Exclusive latch, required for modifying the page.
+    Exclusive,
+    /// No latch at all, the page is only kept resident. Reads must be
+    /// validated with `BufferFrame::read_version()` and
+    /// `BufferFrame::validate()` since writers may modify the page
+    /// concurrently. Optimistic fixes are not reported to the replacement
+    /// policy, `BufferManager::read_optimistic()` does not even fix the
+    /// page.
+    Optimistic
+};
+
 class buffer_full_error : public std::exception {
   public:
     [[nodiscard]] const char* what() const noexcept override {
@@ -62,28 +236,496 @@ class buffer_full_error : public std::exception {
     }
 };
 
+/// Tuning knobs of the `BufferManager` beyond page size and page count.
+struct BufferManagerOptions {
+    /// Number of independent partitions the pool is split into. Page ids are
+    /// hashed to a partition and every partition has its own page table,
+    /// replacement lists, frames and latch, so fixes of pages in different
+    /// partitions never contend. With more than one partition the 2Q
+    /// replacement is only approximated globally.
+    size_t partition_count = 1;
+
+    /// Fraction of the frames at the eviction end of every partition's
+    /// FIFO/LRU lists that a background page cleaner thread keeps clean by
+    /// writing them to disk ahead of their eviction. Fixes that have to evict
+    /// then usually find a clean victim and only pay for reading the new
+    /// page. 0 disables the page cleaner.
+    double target_clean_ratio = 0.0;
+
+    /// How long the page cleaner sleeps between two rounds over all
+    /// partitions.
+    std::chrono::milliseconds cleaner_interval{10};
+
+    /// Maximum number of segment files that are kept open for page I/O. With
+    /// 0, the segment file is opened and closed for every read and write.
+    size_t max_open_files = 64;
+
+    /// `File::IOMode` of the segment files. With `File::SYNC`, every page
+    /// write is durable on its own. With `File::BUFFERED` and `File::DIRECT`
+    /// pages are only durable after `BufferManager::flush_all()`, so the
+    /// cost of flushing the device is paid once per batch. `File::DIRECT`
+    /// requires the page size to be a multiple of 4 KiB and is replaced by
+    /// `File::BUFFERED` otherwise.
+    File::IOMode io_mode = File::SYNC;
+
+    /// Page replacement strategy of every partition. `get_fifo_list()` and
+    /// `get_lru_list()` are only filled by `ReplacementStrategy::TwoQ`.
+    ReplacementStrategy replacement = ReplacementStrategy::TwoQ;
+
+    /// K of `ReplacementStrategy::LruK`.
+    size_t lru_k = 2;
+
+    /// Maximum number of pages that are read ahead when a thread fixes
+    /// consecutive pages of a segment. The read-ahead window starts small
+    /// and doubles while the thread keeps consuming the prefetched pages.
+    /// 0 disables the automatic read-ahead.
+    size_t max_read_ahead = 0;
+
+    /// Maximum number of dirty pages that are written with a single
+    /// vectored write. Pages with adjacent page ids of a segment that are
+    /// written back together, on eviction, by the page cleaner or by
+    /// `flush_all()`, are combined into one write. 1 writes every page on
+    /// its own.
+    size_t max_write_pages = 32;
+
+    /// Interval at which a background thread writes `BufferManager::stats()`
+    /// to `stats_stream`. 0 disables the periodic dump.
+    std::chrono::milliseconds stats_interval{0};
+
+    /// Stream the periodic statistics dump is written to.
+    std::ostream* stats_stream = &std::clog;
+
+    /// Write-ahead log for `BufferManager::log_update()`. The log must
+    /// outlive the buffer manager. The constructor redoes the log, and pages
+    /// are only written after the log records of their modifications are
+    /// durable, so modifications are durable once their records are and the
+    /// segment files can use `File::BUFFERED`.
+    LogManager* log = nullptr;
+
+    /// Largest page count `BufferManager::resize()` can grow the pool to.
+    /// Address space and frame descriptors are reserved for this many pages
+    /// up front, physical memory only for the pages in use. Values below
+    /// the initial page count are raised to it.
+    size_t max_page_count = 0;
+
+    /// Spreads the memory of every partition over the NUMA nodes in chunks
+    /// of 2 MiB and hands free frames to misses from the node of the thread
+    /// that misses first, so pages that a thread loads are local to it as
+    /// long as its node has free frames. Has no effect on machines with a
+    /// single node. false keeps a single free list per partition.
+    bool numa_aware = false;
+
+    /// NUMA node the page cleaner thread is pinned to, see
+    /// `NumaTopology`. -1 or a node that does not exist leaves it unpinned.
+    int cleaner_node = -1;
+
+    /// Backs pools of at least 2 MiB with huge pages, so that fixes of
+    /// random pages cause fewer TLB misses. Explicit huge pages
+    /// (`MAP_HUGETLB`) are used if enough of them are configured in
+    /// `/proc/sys/vm/nr_hugepages` for `max_page_count` pages, the pool is
+    /// then rounded up to whole huge pages and fully allocated up front.
+    /// Otherwise transparent huge pages are requested with `madvise()`.
+    /// false maps the pool with 4 KiB pages only and commits memory only for
+    /// the pages in use.
+    bool huge_pages = false;
+};
+
+/// Statistics counters of one thread for one `BufferManager`. Only the
+/// thread itself writes them, so they are updated without read-modify-write
+/// instructions and are summed up only when the statistics are queried.
+struct alignas(64) ThreadCounters {
+    /// Number of buckets of the miss latency histogram.
+    static constexpr size_t latency_buckets = 32;
+
+    std::thread::id owner;
+
+    std::atomic<uint64_t> hits = 0;
+    std::atomic<uint64_t> misses = 0;
+    std::atomic<uint64_t> evictions = 0;
+    std::atomic<uint64_t> dirty_writes = 0;
+    std::atomic<uint64_t> write_requests = 0;
+
+    // contended acquisitions of partition and frame latches, wait time in
+    // nanoseconds
+    std::atomic<uint64_t> latch_waits = 0;
+    std::atomic<uint64_t> latch_wait_time = 0;
+
+    // `fix_page_wait()` calls that waited for a frame, wait time in
+    // nanoseconds
+    std::atomic<uint64_t> waits = 0;
+    std::atomic<uint64_t> timeouts = 0;
+    std::atomic<uint64_t> wait_time = 0;
+
+    std::atomic<uint64_t> prefetches_issued = 0;
+    std::atomic<uint64_t> prefetches_used = 0;
+    std::atomic<uint64_t> prefetches_wasted = 0;
+
+    // see `BufferManager::Stats::miss_latency`
+    std::array<std::atomic<uint64_t>, latency_buckets> miss_latency{};
+
+    /// Adds `value` to a counter of the calling thread.
+    static void add(std::atomic<uint64_t>& counter, uint64_t value = 1) {
+        counter.store(counter.load(std::memory_order_relaxed) + value,
+                      std::memory_order_relaxed);
+    }
+};
+
+/// The frames a `ScanCursor` loaded its pages into, see `BufferManager`.
+struct ScanRing {
+    struct Slot {
+        BufferFrame* frame;
+        // the page the scan loaded into the frame
+        uint64_t page_id;
+    };
+
+    // oldest first
+    std::vector<Slot> slots;
+    // maximum number of slots
+    size_t capacity = 0;
+};
+
 class BufferManager {
   private:
-    // TODO: add your implementation here
+    friend class ScanCursor;
+
+    /// An independent part of the buffer pool. All members except the frame
+    /// latches and fix counts are protected by `latch`.
+    struct Partition {
+        std::mutex latch;
+
+        // the frames of the partition, frame i holds its page in slot i of
+        // `buffer`
+        std::unique_ptr<BufferFrame[]> frames;
+
+        // frames that do not hold a page yet per NUMA node, handed out from
+        // the back
+        std::vector<std::vector<BufferFrame*>> free_frames;
+
+        // page id -> index into `frames` for the resident pages
+        PageTable page_table{0};
+
+        // the memory of the partition's frames
+        char* buffer = nullptr;
+
+        // number of frames of the partition that are in use. The frames
+        // from here up to `max_page_count` are retired, they are unpinnable
+        // and do not hold a page once `resize()` is done with them.
+        size_t page_count = 0;
+
+        // number of frames allocated for the partition
+        size_t max_page_count = 0;
+
+        // decides which frame is evicted next
+        std::unique_ptr<ReplacementPolicy> policy;
+
+        // notified when a frame becomes unfixed while `waiters` > 0
+        std::condition_variable frame_unfixed;
+        std::atomic<size_t> waiters = 0;
+    };
+
+    struct PoolDeleter {
+        // size of the mapping and of the pages it is mapped with
+        size_t size;
+        size_t page_size;
+        void operator()(char* memory) const;
+    };
+
+    // memory of all frames, reserved for `max_page_count` pages
+    std::unique_ptr<char[], PoolDeleter> buffer;
+
+    const size_t page_size;
+    // the current number of frames, protected by `resize_latch`
+    std::atomic<size_t> page_count;
+    const size_t max_page_count;
+    const File::IOMode io_mode;
+
+    // number of NUMA nodes the frames are spread over, 1 without NUMA
+    // awareness, and the number of consecutive frames on the same node
+    const size_t numa_nodes;
+    const size_t numa_chunk;
+
+    std::unique_ptr<Partition[]> partitions;
+    size_t partition_count;
+
+    // open segment files shared by all page I/O
+    SegmentFileCache segment_files;
+
+    // number of prefetch reads in flight. Shared with their completion
+    // callbacks, which may still wake up the destructor after it saw the
+    // count drop to 0 and freed the buffer manager.
+    std::shared_ptr<std::atomic<size_t>> pending_reads =
+        std::make_shared<std::atomic<size_t>>(0);
+
+    // distinguishes the read-ahead state of this instance from that of
+    // other instances in the same thread
+    const uint64_t instance_id;
+    const size_t max_read_ahead;
+    const size_t max_write_pages;
+
+    // write-ahead log, may be nullptr
+    LogManager* const log;
+
+    // the statistics counters of all threads that used this instance,
+    // protected by `counters_latch`
+    mutable std::mutex counters_latch;
+    std::vector<std::unique_ptr<ThreadCounters>> all_counters;
+
+    const double target_clean_ratio;
+    const std::chrono::milliseconds cleaner_interval;
+    const int cleaner_node;
+    const std::chrono::milliseconds stats_interval;
+    std::ostream* const stats_stream;
+
+    // serializes `resize()` calls
+    std::mutex resize_latch;
+
+    // background page cleaner, only running if target_clean_ratio > 0
+    std::thread page_cleaner;
+    // background statistics dump, only running if stats_interval > 0
+    std::thread stats_dumper;
+    // protects `stop_threads`
+    std::mutex cleaner_latch;
+    std::condition_variable cleaner_cv;
+    std::condition_variable stats_cv;
+    bool stop_threads = false;
+
+    /// Main loop of the page cleaner thread.
+    void run_page_cleaner();
+
+    /// Main loop of the statistics dump thread.
+    void run_stats_dumper();
+
+    /// Returns the statistics counters of the calling thread, registering
+    /// them on the first call of the thread.
+    ThreadCounters& counters();
+
+    /// Sums up the counters of all threads.
+    void sum_counters(ThreadCounters& sum) const;
+
+    /// Locks a partition latch and counts the wait if it is contended.
+    void lock_partition(std::unique_lock<std::mutex>& partition_lock);
+
+    /// Counts a latch acquisition that started waiting at `start`.
+    void add_latch_wait(std::chrono::steady_clock::time_point start);
+
+    /// Writes the dirty, unfixed frames among the first frames that would be
+    /// evicted from `partition`. Returns the number of written frames.
+    size_t clean_partition(Partition& partition);
+
+    /// Writes the frames that are still dirty under a shared latch and
+    /// unfixes them. Frames of adjacent pages are written together. The
+    /// frames must have been fixed without a latch (only their fix count
+    /// was incremented). Rethrows the first write error after all frames
+    /// were processed.
+    void write_fixed_frames(std::vector<BufferFrame*> frames);
+
+    /// Returns the partition that is responsible for a page id.
+    Partition& get_partition(uint64_t page_id);
+
+    /// @brief takes a free frame or evicts a page and registers the frame for
+    /// the new page. The frame is returned fixed once and with `io_pending`
+    /// set, the caller has to read the page and clear it. With a `ring`, a
+    /// frame of the ring is recycled if possible and the frame is added to
+    /// the ring.
+    /// @return the frame or nullptr if all frames are fixed
+    BufferFrame* allocate_frame(Partition& partition, uint64_t page_id,
+                                ScanRing* ring = nullptr);
+
+    /// Undoes `allocate_frame()` for a frame whose page was not read: the
+    /// page is dropped and the frame becomes free again. Does nothing and
+    /// returns false if another thread fixed the page in the meantime, the
+    /// page has to be read for it then. Must be called with the partition
+    /// latch held.
+    bool discard_frame(Partition& partition, BufferFrame& frame);
+
+    /// Handles a failed read of a frame returned by `allocate_frame()`: the
+    /// frame is discarded, so that the next fix reads the page again, or if
+    /// other threads fixed the page meanwhile, the first of them reads it
+    /// again. Releases the fix of the reading thread. Must be called with
+    /// the partition latch held.
+    void fail_read(Partition& partition, BufferFrame& frame);
+
+    /// Waits for a pending read of a fixed frame and reads the page again if
+    /// that read failed. Releases the fix and rethrows if that fails as well.
+    void wait_for_read(BufferFrame& frame);
+
+    /// Maps at least `size` bytes for frames, aligned to at least 4 KiB. With
+    /// `huge_pages`, explicit huge pages are tried first and transparent
+    /// huge pages are requested otherwise, without them both are disabled.
+    static std::unique_ptr<char[], PoolDeleter> allocate_pool(size_t size,
+                                                              bool huge_pages);
+
+    /// Returns the NUMA node of the frame with the given index in its
+    /// partition.
+    [[nodiscard]] size_t frame_node(size_t index) const {
+        return index / numa_chunk % numa_nodes;
+    }
+
+    /// Takes a free frame of `partition`, preferring the NUMA node of the
+    /// calling thread. Returns nullptr if there is none.
+    BufferFrame* take_free_frame(Partition& partition);
 
-    // hash table for all buffer frames
-    std::unordered_map<uint64_t, BufferFrame> bufferframes;
-    std::unique_ptr<char[]> buffer;
+    /// Claims the oldest frame of a full ring that belongs to `partition`
+    /// and still holds the page the scan loaded into it. Returns nullptr if
+    /// there is none.
+    static BufferFrame* take_ring_frame(Partition& partition, ScanRing& ring);
 
-    const size_t page_size, page_count;
-    size_t free_pos = 0;
+    /// Starts reading a page that is not resident asynchronously, see
+    /// `prefetch()`.
+    void prefetch_page(uint64_t page_id, ScanRing* ring);
 
-    std::mutex manager_latch;
-    std::mutex fifo_latch;
-    std::mutex lru_latch;
+    /// Detects whether the calling thread fixes consecutive pages of the
+    /// segment of `page_id` and prefetches the following pages if so. Does
+    /// not throw, pages that cannot be prefetched are read by their fixes.
+    void read_ahead(uint64_t page_id) noexcept;
 
-    // FIFO queue for 2Q strategy
-    std::deque<uint64_t> fifo;
+    /// Returns true and counts the use if the frame holds a prefetched page
+    /// that was not fixed since it was prefetched.
+    bool take_prefetched(BufferFrame& frame);
 
-    // LRU queue for 2Q strategy
-    std::deque<uint64_t> lru;
+    /// Fixes a page shared for a `ScanCursor` without changing the
+    /// replacement order, loading it into a frame of `ring`.
+    BufferFrame& fix_scan_page(uint64_t page_id, ScanRing& ring);
+
+    /// @brief read page from disk into memory
+    void read_frame(BufferFrame& frame);
+
+    /// @brief read pages from disk into memory, all reads are started before
+    /// the first one is waited for. Failed reads are retried synchronously.
+    /// @return the error of every page, nullptr for the pages that were read
+    std::vector<std::exception_ptr>
+    read_frames(std::span<BufferFrame* const> frames);
+
+    /// Looks up a resident page for an optimistic read without writing any
+    /// shared memory. Returns the frame and sets `version` to the version
+    /// to validate the read against, returns nullptr if the page is not
+    /// resident or is being evicted.
+    BufferFrame* find_optimistic(uint64_t page_id, uint64_t& version);
+
+    /// Clears `io_pending` of a frame whose read finished, which makes the
+    /// page visible to optimistic readers.
+    static void finish_read(BufferFrame& frame);
+
+    /// Fixes a resident page without taking the partition latch, returns
+    /// nullptr if the page is not resident or is currently being evicted.
+    /// Hits are not reported to the replacement policy without `touch`.
+    BufferFrame* try_fix_resident(Partition& partition, uint64_t page_id,
+                                  bool touch = true);
+
+    /// Pins the frame of a page with the partition latch held. If the frame
+    /// is claimed by an eviction, the latch is released until the claim is
+    /// resolved. Returns nullptr if the page is not resident.
+    BufferFrame* pin_resident(Partition& partition, uint64_t page_id,
+                              std::unique_lock<std::mutex>& partition_lock);
+
+    /// Fixes a page with the partition latch held and releases the latch,
+    /// the frame is not latched yet. Returns nullptr and keeps the latch if
+    /// no frame can be evicted. With a `ring`, the page is fixed for a scan
+    /// like in `fix_scan_page()`. Hits are not reported to the replacement
+    /// policy without `touch`.
+    BufferFrame* fix_locked(Partition& partition, uint64_t page_id,
+                            std::unique_lock<std::mutex>& partition_lock,
+                            ScanRing* ring = nullptr, bool touch = true);
+
+    /// Decrements the fix count of a frame of `partition` and wakes up
+    /// threads waiting for a frame if it drops to zero.
+    static void unpin(Partition& partition, BufferFrame& frame);
+
+    /// Like `unpin()` but with the partition latch held.
+    static void unpin_locked(Partition& partition, BufferFrame& frame);
+
+    /// @brief lock a frame in the given mode, does nothing for optimistic
+    /// access. Waits for a pending read of the page like `wait_for_read()`.
+    void lock_frame(BufferFrame& frame, AccessMode mode);
+
+    /// @brief write a claimed frame to disk if it is dirty, together with
+    /// the dirty, unlatched frames of adjacent pages in the same partition.
+    /// Must be called with the partition latch held.
+    void write_back_to_disk(Partition& partition, BufferFrame& frame);
+
+    /// @brief write frames of adjacent pages of one segment to disk
+    /// unconditionally with a single write
+    void write_frames(std::span<BufferFrame* const> frames);
+
+    /// @brief write the images of adjacent pages of one segment, starting
+    /// with `page_id`, to disk with a single write after flushing the log up
+    /// to `page_lsn`
+    void write_pages(uint64_t page_id, std::span<const char* const> blocks,
+                     uint64_t page_lsn);
+
+    /// Applies the records of the log since its redo LSN to the pages.
+    void recover();
+
+    /// @brief evict a page from buffer frames, the frame can be reused
+    /// afterwards
+    void evict(Partition& partition, BufferFrame* frame);
+
+    /// Changes the number of frames of a partition, see `resize()`.
+    void resize_partition(Partition& partition, size_t new_count);
 
   public:
+    /// Statistics of `fix_page_wait()` calls that had to wait for a frame.
+    struct WaitStats {
+        /// Number of calls that waited.
+        size_t waits = 0;
+        /// Number of calls that gave up at their deadline.
+        size_t timeouts = 0;
+        /// Total time spent waiting.
+        std::chrono::nanoseconds wait_time{0};
+    };
+
+    /// Counters of the pages read by prefetches.
+    struct PrefetchStats {
+        /// Number of pages whose read was started.
+        size_t issued = 0;
+        /// Number of prefetched pages that were fixed afterwards.
+        size_t used = 0;
+        /// Number of prefetched pages that were evicted without being fixed.
+        size_t wasted = 0;
+    };
+
+    /// Snapshot of the statistics of the buffer manager, see `stats()`.
+    struct Stats {
+        /// Number of fixes that found their page in memory.
+        size_t hits = 0;
+        /// Number of fixes that had to read their page from disk.
+        size_t misses = 0;
+        /// Number of pages that were evicted to make room for another page.
+        size_t evictions = 0;
+        /// Number of dirty pages written to disk, on eviction, by the page
+        /// cleaner or by `flush_all()`.
+        size_t dirty_writes = 0;
+        /// Number of writes these pages took, adjacent pages are written
+        /// with a single write.
+        size_t write_requests = 0;
+        /// Number of partition and frame latch acquisitions that had to
+        /// wait, and the total time they waited.
+        size_t latch_waits = 0;
+        std::chrono::nanoseconds latch_wait_time{0};
+        /// See `get_wait_stats()`.
+        WaitStats waits;
+        /// See `get_prefetch_stats()`.
+        PrefetchStats prefetches;
+        /// Histogram of the time it took to load a page on a miss,
+        /// including the eviction of the previous page. Bucket i counts the
+        /// misses that took less than 2^i ns but at least 2^(i-1) ns, the
+        /// last bucket also counts all slower misses.
+        std::array<size_t, ThreadCounters::latency_buckets> miss_latency{};
+        /// Number of frames holding a page and how many of them are dirty.
+        size_t resident_pages = 0;
+        size_t dirty_pages = 0;
+        /// Number of resident pages per segment.
+        std::map<uint16_t, size_t> segment_pages;
+
+        /// Returns the fraction of fixes that were hits.
+        [[nodiscard]] double hit_ratio() const;
+
+        /// Returns an upper bound of the given quantile (between 0 and 1) of
+        /// the miss latency.
+        [[nodiscard]] std::chrono::nanoseconds
+        miss_latency_quantile(double quantile) const;
+    };
+
     BufferManager(const BufferManager&) = delete;
     BufferManager(BufferManager&&) = delete;
     BufferManager& operator=(const BufferManager&) = delete;
@@ -92,11 +734,54 @@ class BufferManager {
     /// @param[in] page_size  Size in bytes that all pages will have.
     /// @param[in] page_count Maximum number of pages that should reside in
     //                        memory at the same time.
-    BufferManager(size_t page_size, size_t page_count);
+    /// @param[in] options    Further configuration, see
+    ///                       `BufferManagerOptions`.
+    BufferManager(size_t page_size, size_t page_count,
+                  BufferManagerOptions options = {});
 
     /// Destructor. Writes all dirty pages to disk.
     ~BufferManager();
 
+    /// Writes all dirty pages to disk and flushes the segment files to the
+    /// device, so all modifications of pages unfixed before the call are
+    /// durable afterwards. Waits for pages that are fixed exclusively, so the
+    /// caller must not hold any exclusive fixes.
+    /// Is thread-safe w.r.t. `fix_page()` and `unfix_page()`.
+    void flush_all();
+
+    /// Writes all pages that are dirty when the call starts to disk in
+    /// (segment, page) order and flushes the segment files to the device,
+    /// while other threads keep fixing pages. Every page is only latched
+    /// shared for copying it, the copies are written without holding any
+    /// latch. The pages stay fixed until their copies are written, so they
+    /// are not evicted meanwhile. Pages that are modified again after they
+    /// were copied stay dirty. Returns the number of pages written. With a log, the redo
+    /// LSN of the log is advanced to the start of the checkpoint.
+    /// Is thread-safe w.r.t. all other calls, the caller must not hold any
+    /// exclusive fixes.
+    size_t checkpoint();
+
+    /// Changes the number of frames to `new_page_count`, clamped to between
+    /// the partition count and `BufferManagerOptions::max_page_count`.
+    /// Growing hands out frames from the reserved memory without moving the
+    /// existing ones. Shrinking evicts the pages of the frames at the end of
+    /// every partition, writing them if they are dirty, waits for those that
+    /// are fixed and returns their memory to the operating system.
+    /// Is thread-safe w.r.t. all other calls, the caller must not hold any
+    /// fixes.
+    void resize(size_t new_page_count);
+
+    /// Returns size of a page
+    [[nodiscard]] size_t get_page_size() const { return page_size; }
+
+    /// Returns the current number of frames.
+    [[nodiscard]] size_t get_page_count() const;
+
+    /// Returns the size of the pages the pool is mapped with, 2 MiB for
+    /// explicit huge pages and 4 KiB otherwise, even if the kernel backs
+    /// parts of it with transparent huge pages.
+    [[nodiscard]] size_t get_pool_page_size() const;
+
     /// Returns a reference to a `BufferFrame` object for a given page id. When
     /// the page is not loaded into memory, it is read from disk. Otherwise the
     /// loaded page is used.
@@ -107,23 +792,138 @@ class BufferManager {
     /// @param[in] exclusive If `exclusive` is true, the page is locked
     ///                      exclusively. Otherwise it is locked
     ///                      non-exclusively (shared).
-    BufferFrame& fix_page(uint64_t page_id, bool exclusive);
+    BufferFrame& fix_page(uint64_t page_id, bool exclusive) {
+        return fix_page(page_id,
+                        exclusive ? AccessMode::Exclusive : AccessMode::Shared);
+    }
+
+    /// Like `fix_page(page_id, exclusive)` but additionally allows to fix a
+    /// page with `AccessMode::Optimistic`. Optimistically fixed pages are
+    /// kept resident but are not latched and must be released with
+    /// `unfix_optimistic()`.
+    BufferFrame& fix_page(uint64_t page_id, AccessMode mode);
 
     /// Takes a `BufferFrame` reference that was returned by an earlier call to
     /// `fix_page()` and unfixes it. When `is_dirty` is / true, the page is
     /// written back to disk eventually.
     void unfix_page(BufferFrame& page, bool is_dirty);
 
+    /// Like `fix_page(page_id, mode)` but when the page cannot be loaded
+    /// because all frames of its partition are fixed, blocks until a frame is
+    /// unfixed instead of throwing `buffer_full_error`. Returns nullptr if no
+    /// frame became available until `deadline`.
+    /// Is thread-safe w.r.t. other concurrent calls to `fix_page()`,
+    /// `fix_page_wait()` and `unfix_page()`.
+    BufferFrame* fix_page_wait(
+        uint64_t page_id, AccessMode mode,
+        std::chrono::steady_clock::time_point deadline =
+            std::chrono::steady_clock::time_point::max());
+
+    /// Fixes all given pages like `fix_page(page_id, mode)` and returns their
+    /// frames in the order of `page_ids`. Resident pages are fixed without
+    /// latching their partition, every other partition latch is acquired
+    /// once for all pages of the partition, and the reads of all missed
+    /// pages are in flight at the same time. A page that is given
+    /// several times is fixed once and its frame is returned for every
+    /// occurrence. The pages are latched in page id order, so concurrent
+    /// batches cannot deadlock each other. When the pages do not fit into
+    /// the buffer at the same time, no page stays fixed and
+    /// `buffer_full_error` is thrown.
+    /// Is thread-safe w.r.t. other concurrent calls to `fix_page()`,
+    /// `fix_pages()` and `unfix_page()`.
+    std::vector<BufferFrame*> fix_pages(std::span<const uint64_t> page_ids,
+                                        AccessMode mode);
+
+    /// Unfixes the frames returned by `fix_pages()` with
+    /// `AccessMode::Shared` or `AccessMode::Exclusive`, every frame once no
+    /// matter how often it occurs in `pages`. Frames fixed with
+    /// `AccessMode::Optimistic` are released with `unfix_optimistic()`
+    /// once per distinct frame instead.
+    void unfix_pages(std::span<BufferFrame* const> pages, bool is_dirty);
+
+    /// Returns a snapshot of the statistics. The counters are kept per thread
+    /// and summed up by the call, the residency is counted under the
+    /// partition latches.
+    /// Is thread-safe w.r.t. all other calls.
+    [[nodiscard]] Stats stats() const;
+
+    /// Returns how often and how long `fix_page_wait()` waited for a frame.
+    [[nodiscard]] WaitStats get_wait_stats() const;
+
+    /// Returns the prefetch counters, covering `prefetch()`, the read-ahead
+    /// of `ScanCursor` and the automatic read-ahead.
+    [[nodiscard]] PrefetchStats get_prefetch_stats() const;
+
+    /// Latches a page that is fixed shared by the caller exclusively without
+    /// unfixing it. The shared latch is kept while the other readers drain,
+    /// so no writer can modify the page in between. Returns false and keeps
+    /// the page latched shared if another thread is upgrading it already,
+    /// the caller then has to unfix it and fix it exclusively instead.
+    bool upgrade_page(BufferFrame& page);
+
+    /// Latches a page that is fixed exclusively by the caller shared without
+    /// unfixing it or letting a writer in. When `is_dirty` is true, the page
+    /// is written back to disk eventually.
+    void downgrade_page(BufferFrame& page, bool is_dirty);
+
+    /// Appends a redo record of `length` bytes at `offset` of a page that is
+    /// fixed exclusively by the caller to the log and returns its LSN. The
+    /// bytes must already hold their new value. The modification is durable
+    /// once the log is flushed up to the LSN, see `LogManager::flush()`.
+    /// Requires `BufferManagerOptions::log`.
+    uint64_t log_update(BufferFrame& page, size_t offset, size_t length);
+
+    /// Unfixes a page that was fixed with `AccessMode::Optimistic`.
+    void unfix_optimistic(BufferFrame& page);
+
+    /// Starts reading the given pages that are not in memory yet without
+    /// fixing them, so that later fixes of these pages overlap with the I/O
+    /// instead of waiting for it. Uses io_uring when available and reads
+    /// synchronously otherwise. Pages for which no frame can be evicted are
+    /// skipped.
+    /// Is thread-safe w.r.t. `fix_page()` and `unfix_page()`.
+    void prefetch(std::span<const uint64_t> page_ids);
+
+    /// Calls `read(const char* data)` on a resident page until it observed
+    /// a consistent page, i.e. until no writer modified the page and the
+    /// page was not evicted during the call. The page is neither fixed nor
+    /// latched for that, so readers do not write any shared memory. A page
+    /// that is not resident is fixed shared and read once. Returns the
+    /// result of the last call. `read` must tolerate inconsistent data and
+    /// must not write to the page.
+    template <typename Fn>
+    auto read_optimistic(uint64_t page_id, Fn&& read) {
+        uint64_t version = 0;
+        while (auto* page = find_optimistic(page_id, version)) {
+            auto result = read(static_cast<const char*>(page->get_data()));
+            if (page->validate(version)) {
+                return result;
+            }
+        }
+        auto& page = fix_page(page_id, AccessMode::Shared);
+        auto result = read(static_cast<const char*>(page.get_data()));
+        unfix_page(page, false);
+        return result;
+    }
+
     /// Returns the page ids of all pages (fixed and unfixed) that are in the
-    /// FIFO list in FIFO order.
+    /// FIFO list in FIFO order. With several partitions, the lists of the
+    /// partitions are concatenated.
     /// Is not thread-safe.
     [[nodiscard]] std::vector<uint64_t> get_fifo_list() const;
 
     /// Returns the page ids of all pages (fixed and unfixed) that are in the
-    /// LRU list in LRU order.
+    /// LRU list in LRU order. With several partitions, the lists of the
+    /// partitions are concatenated.
     /// Is not thread-safe.
     [[nodiscard]] std::vector<uint64_t> get_lru_list() const;
 
+    /// Returns the number of fixes that found their page in memory.
+    [[nodiscard]] size_t get_hit_count() const;
+
+    /// Returns the number of fixes that had to read their page from disk.
+    [[nodiscard]] size_t get_miss_count() const;
+
     /// Returns the segment id for a given page id which is contained in the 16
     /// most significant bits of the page id.
     static constexpr uint16_t get_segment_id(uint64_t page_id) {
@@ -135,32 +935,11 @@ class BufferManager {
     static constexpr uint64_t get_segment_page_id(uint64_t page_id) {
         return page_id & ((1ull << 48) - 1);
     }
-
-    /// @brief read page from disk into memory
-    /// @param page_id
-    void read_frame(uint64_t page_id,
-                    std::unique_lock<std::mutex>& manager_lock);
-
-    /// @brief lock a frame
-    /// @param page_id
-    /// @param exclusive if true, lock it exclusivly; false lock it shared
-    void lock_frame(uint64_t page_id, bool exclusive);
-
-    /// @brief unlock a frame
-    /// @param page_id
-    void unlock_frame(uint64_t page_id);
-
-    /// @brief check whether there is page can be evicted from buffer frames
-    /// @return true if one page can be evicted
-    BufferFrame* evict_check();
-
-    void write_back_to_disk(BufferFrame* frame,
-                            std::unique_lock<std::mutex>& manager_lock);
-
-    /// @brief evict a page from buffer frames
-    void evict(BufferFrame* frame, std::unique_lock<std::mutex>& manager_lock);
 };
 
+/// Writes the statistics as a single line of `key=value` pairs.
+std::ostream& operator<<(std::ostream& out, const BufferManager::Stats& stats);
+
 } // namespace moderndbs
 
 #endif
@@ -2,7 +2,9 @@
 #define INCLUDE_MODERNDBS_FILE_H_
 
 #include <cstdint>
+#include <functional>
 #include <memory>
+#include <span>
 
 
 namespace moderndbs {
@@ -15,6 +17,21 @@ public:
     /// File mode (read or write)
     enum Mode { READ, WRITE };
 
+    /// How reads and writes of the file interact with the OS page cache
+    enum IOMode {
+        /// Every write is flushed to the device before it returns
+        /// (`O_SYNC`).
+        SYNC,
+        /// Writes go to the OS page cache, durability requires `sync()`.
+        BUFFERED,
+        /// Reads and writes bypass the OS page cache (`O_DIRECT`),
+        /// durability requires `sync()`. Offsets, sizes and memory of all
+        /// I/O must be aligned to the logical block size of the device.
+        /// Falls back to `BUFFERED` if the file system does not support
+        /// direct I/O.
+        DIRECT
+    };
+
     File() = default;
     File(const File&) = default;
     File(File&&) = default;
@@ -29,6 +46,11 @@ public:
     /// Is not thread-safe w.r.t concurrent calls to `resize()`.
     [[nodiscard]] virtual size_t size() const = 0;
 
+    /// Returns the size of the file as the file system reports it now. Unlike
+    /// `size()` it includes blocks written past the end with `write_block()`,
+    /// also through other handles of the file.
+    [[nodiscard]] virtual size_t read_size() const = 0;
+
     /// Resizes the file to `new_size`. If `new_size` is smaller than `size()`,
     /// the file is cut off at the end. Otherwise zero bytes are appended at
     /// the end.
@@ -46,6 +68,19 @@ public:
     ///                    Must be able to hold at least `size` bytes.
     virtual void read_block(size_t offset, size_t size, char* block) = 0;
 
+    /// Called once an asynchronous read finished. `error` is 0 on success and
+    /// an `errno` value otherwise.
+    using ReadCallback = std::function<void(int error)>;
+
+    /// Starts reading a block of the file like `read_block()` without waiting
+    /// for the read to finish. `on_complete` is called exactly once, possibly
+    /// from another thread and possibly before this function returns. The
+    /// file and `block` must stay valid until then. The default
+    /// implementation reads synchronously.
+    /// Is thread-safe w.r.t concurrent calls to `read_block()`,
+    /// `read_block_async()` and `write_block()`.
+    virtual void read_block_async(size_t offset, size_t size, char* block, ReadCallback on_complete);
+
     /// Reads a block of the file and returns it.
     [[nodiscard]] std::unique_ptr<char[]> read_block(size_t offset, size_t size) { // NOLINT(cppcoreguidelines-avoid-c-arrays)
         auto block = std::make_unique<char[]>(size);
@@ -66,10 +101,29 @@ public:
     /// @param[in] size   The size of the block.
     virtual void write_block(const char* block, size_t offset, size_t size) = 0;
 
+    /// Writes several blocks of `block_size` bytes that are adjacent in the
+    /// file, starting at `offset`, like `write_block()` with the blocks
+    /// copied into one buffer. The default implementation writes every
+    /// block on its own.
+    /// Is thread-safe w.r.t concurrent calls to `read_block()`,
+    /// `write_block()` and `write_blocks()`.
+    /// @param[in] blocks     Pointers to the memory of the blocks in file
+    ///                       order. Every one must hold `block_size` bytes.
+    /// @param[in] offset     The offset in the file at which the first block
+    ///                       should be written.
+    /// @param[in] block_size The size of every block.
+    virtual void write_blocks(std::span<const char* const> blocks, size_t offset, size_t block_size);
+
+    /// Flushes all data written to the file to the device.
+    /// Is thread-safe w.r.t concurrent calls to `read_block()` and
+    /// `write_block()`.
+    virtual void sync() = 0;
+
     /// Opens a file with the given mode. Existing files are never overwritten.
     /// @param[in] filename Path to the file.
     /// @param[in] mode     `Mode` that should be used to open the file.
-    [[nodiscard]] static std::unique_ptr<File> open_file(const char* filename, Mode mode);
+    /// @param[in] io_mode  `IOMode` that should be used for the file.
+    [[nodiscard]] static std::unique_ptr<File> open_file(const char* filename, Mode mode, IOMode io_mode = SYNC);
 
     /// Opens a temporary file in `WRITE` mode. The file will be deleted
     /// automatically after use.
@@ -82,12 +136,10 @@ private:
     Mode mode;
     int fd;
     size_t cached_size;
-    
-    [[nodiscard]] size_t read_size() const;
 
 public:
     PosixFile(Mode mode, int fd, size_t size);
-    PosixFile(const char* filename, Mode mode);
+    PosixFile(const char* filename, Mode mode, IOMode io_mode = SYNC);
     PosixFile(const PosixFile&) = delete;
     PosixFile(PosixFile&&) = delete;
     PosixFile& operator=(const PosixFile&) = delete;
@@ -99,11 +151,21 @@ public:
 
     [[nodiscard]] size_t size() const override;
 
+    [[nodiscard]] size_t read_size() const override;
+
     void resize (size_t new_size) override;
 
     void read_block(size_t offset, size_t, char* block) override;
 
+    /// Reads through io_uring if the system supports it.
+    void read_block_async(size_t offset, size_t size, char* block, ReadCallback on_complete) override;
+
     void write_block (const char* block, size_t offset, size_t size) override;
+
+    /// Writes all blocks with `pwritev()`.
+    void write_blocks(std::span<const char* const> blocks, size_t offset, size_t block_size) override;
+
+    void sync() override;
  };
 
 }  // namespace moderndbs
@@ -0,0 +1,87 @@
+#ifndef INCLUDE_MODERNDBS_IO_URING_H_
+#define INCLUDE_MODERNDBS_IO_URING_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace moderndbs {
+
+///
+/// Minimal io_uring submission/completion ring for asynchronous reads on
+/// file descriptors. Completions are reaped by a background thread that
+/// invokes the callbacks.
+///
+class IoUring {
+public:
+    /// Called once a read finished. `error` is 0 on success and an `errno`
+    /// value otherwise.
+    using Callback = std::function<void(int error)>;
+
+    IoUring(const IoUring&) = delete;
+    IoUring(IoUring&&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+    IoUring& operator=(IoUring&&) = delete;
+    ~IoUring();
+
+    /// Returns the ring shared by the whole process or nullptr when io_uring
+    /// is not available (old kernel, seccomp, non-Linux system).
+    [[nodiscard]] static IoUring* get();
+
+    /// Reads `size` bytes at `offset` of `fd` into `block`. Reads stop early
+    /// at the end of the file. `on_complete` is called exactly once from the
+    /// completion thread, or from the calling thread if the read cannot be
+    /// submitted. It must not submit further reads and should not block for
+    /// long.
+    /// Blocks while too many reads are in flight.
+    /// Is thread-safe.
+    void submit_read(int fd, size_t offset, size_t size, char* block, Callback on_complete);
+
+private:
+    struct Request;
+
+    explicit IoUring(unsigned entries);
+
+    /// Pushes a submission queue entry for `request` and submits it. Returns
+    /// 0 or the `errno` of a submission that failed, the entry is not queued
+    /// then. `submit_latch` must be held.
+    int push(Request* request);
+
+    /// Main loop of the completion thread.
+    void reap();
+
+    int ring_fd = -1;
+    unsigned entries = 0;
+
+    // mapped ring memory
+    void* sq_ring = nullptr;
+    size_t sq_ring_size = 0;
+    void* cq_ring = nullptr;
+    size_t cq_ring_size = 0;
+    void* sqes = nullptr;
+
+    // pointers into the mapped rings
+    unsigned* sq_head = nullptr;
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_mask = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned* cq_mask = nullptr;
+    void* cqes = nullptr;
+
+    // protects the submission queue and `in_flight`
+    std::mutex submit_latch;
+    std::condition_variable submit_cv;
+    size_t in_flight = 0;
+    bool stopping = false;
+
+    std::thread reaper;
+};
+
+}  // namespace moderndbs
+
+#endif
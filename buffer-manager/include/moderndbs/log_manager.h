@@ -0,0 +1,125 @@
+#ifndef INCLUDE_MODERNDBS_LOG_MANAGER_H
+#define INCLUDE_MODERNDBS_LOG_MANAGER_H
+
+#include "moderndbs/file.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+
+namespace moderndbs {
+
+/// Write-ahead log of page-level redo records. A record holds the after
+/// image of a byte range of a page. Records are identified by their log
+/// sequence number (LSN), the offset in the log file just past the record,
+/// so a record is durable once the log is flushed up to its LSN.
+///
+/// Appending threads reserve space in an in-memory ring buffer with a single
+/// atomic add and copy their records concurrently. `flush()` implements
+/// group commit: one thread writes and syncs everything that was appended
+/// so far, while the other threads that want to commit wait for it instead
+/// of syncing the file themselves.
+class LogManager {
+  private:
+    std::unique_ptr<File> file;
+
+    // ring buffer of the records that are not flushed yet, the record with
+    // LSN l ends at offset l % capacity
+    std::unique_ptr<char[]> buffer;
+    const size_t capacity;
+
+    // the end of the reserved part of the log
+    std::atomic<uint64_t> reserved_lsn;
+    // all records before are copied into the buffer
+    std::atomic<uint64_t> filled_lsn;
+    // all records before are durable
+    std::atomic<uint64_t> flushed_lsn;
+
+    // held by the thread that writes the buffer to the file
+    std::mutex flush_latch;
+
+    // the log file is allocated up to here, protected by `flush_latch`
+    uint64_t allocated_lsn = 0;
+
+    // the first record the redo pass has to apply
+    uint64_t redo_lsn;
+
+    // number of syncs of the log file
+    std::atomic<size_t> flush_count = 0;
+
+    /// Copies bytes into the ring buffer at the given log offset.
+    void copy_in(uint64_t lsn, const char* data, size_t size);
+
+    /// Writes the magic number and the redo LSN to the start of the log file
+    /// and syncs it.
+    void write_header();
+
+    /// Writes all filled records that are not flushed yet and syncs the log
+    /// file. Must be called with `flush_latch` held.
+    void write_filled();
+
+  public:
+    /// Size of the record header in bytes.
+    static constexpr size_t header_size = 24;
+
+    /// The LSN of the start of the first record, the log file starts with
+    /// the redo LSN.
+    static constexpr uint64_t first_lsn = 64;
+
+    /// Constructor. Opens or creates the log file and finds the end of the
+    /// log, a torn record at the end is cut off.
+    /// @param[in] filename    Path to the log file.
+    /// @param[in] buffer_size Size of the log buffer, the largest record
+    ///                        that can be appended.
+    explicit LogManager(const char* filename, size_t buffer_size = 1 << 20);
+
+    LogManager(const LogManager&) = delete;
+    LogManager(LogManager&&) = delete;
+    LogManager& operator=(const LogManager&) = delete;
+    LogManager& operator=(LogManager&&) = delete;
+
+    /// Destructor. Flushes the log.
+    ~LogManager();
+
+    /// Appends a redo record that sets `data.size()` bytes at `offset` of a
+    /// page to `data` and returns its LSN. The record is not durable before
+    /// `flush()` was called with its LSN. Throws `std::length_error` if the
+    /// record does not fit into the log buffer.
+    /// Is thread-safe.
+    uint64_t append(uint64_t page_id, uint32_t offset, std::span<const char> data);
+
+    /// Makes all records up to `lsn` durable. Concurrent calls are combined
+    /// into a single sync of the log file.
+    /// Is thread-safe.
+    void flush(uint64_t lsn);
+
+    /// Returns the end of the log, i.e. the LSN the next record starts at.
+    [[nodiscard]] uint64_t get_current_lsn() const;
+
+    /// Returns the LSN up to which the log is durable.
+    [[nodiscard]] uint64_t get_flushed_lsn() const;
+
+    /// Returns how often the log file was synced.
+    [[nodiscard]] size_t get_flush_count() const;
+
+    /// Durably records that the records before `lsn` are no longer needed
+    /// for recovery, because all pages they modified were written since.
+    /// Flushes the log up to `lsn` first.
+    /// Is thread-safe.
+    void set_redo_lsn(uint64_t lsn);
+
+    using RedoCallback =
+        std::function<void(uint64_t page_id, uint32_t offset, std::span<const char> data, uint64_t lsn)>;
+
+    /// Calls `apply` for every durable record since the redo LSN in log
+    /// order. Returns the number of records.
+    /// Is not thread-safe.
+    size_t redo(const RedoCallback& apply);
+};
+
+} // namespace moderndbs
+
+#endif
@@ -0,0 +1,154 @@
+#ifndef INCLUDE_MODERNDBS_MMAP_BUFFER_MANAGER_H
+#define INCLUDE_MODERNDBS_MMAP_BUFFER_MANAGER_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace moderndbs {
+
+/// A page fixed through the `MmapBufferManager`. Frames only exist in the
+/// manager's side table while their page is fixed, the page data itself
+/// lives in the mapping of the segment file.
+class MmapBufferFrame {
+  private:
+    friend class MmapBufferManager;
+
+    uint64_t page_id = 0;
+
+    // how many threads fixed the page, protected by the latch of the shard
+    // of the side table the frame is in
+    size_t thread_cnt = 0;
+
+    // a read/write lock to protect the page
+    std::shared_mutex frame_latch;
+
+    // set while a writer holds `frame_latch`
+    bool exclusive = false;
+
+    // the page in the mapping of its segment
+    char* data = nullptr;
+
+  public:
+    /// Returns a pointer to this page's data.
+    char* get_data() { return data; }
+    [[nodiscard]] const char* get_data() const { return data; }
+};
+
+/// Buffer manager that leaves caching to the kernel. Every segment file is
+/// mapped into memory once and pages are accessed in place, so the page
+/// cache decides which pages are resident and writes dirty pages back. Only
+/// the latches of pages that are currently fixed are kept, in a side table
+/// keyed by page id. It reads and writes the same segment files as
+/// `BufferManager` and has the same `fix_page()`/`unfix_page()` interface,
+/// so that both can be compared on the same workloads.
+class MmapBufferManager {
+  private:
+    /// A mapped segment file.
+    struct Segment {
+        int fd = -1;
+        // start of the mapping, which covers `reservation` bytes
+        char* data = nullptr;
+        // the size of the file, pages beyond must not be touched
+        std::atomic<size_t> size = 0;
+        // held while the file is grown
+        std::mutex grow_latch;
+    };
+
+    /// Part of the side table, page ids are hashed to a shard so that fixes
+    /// of different pages rarely contend.
+    struct alignas(64) Shard {
+        std::mutex latch;
+        std::unordered_map<uint64_t, std::unique_ptr<MmapBufferFrame>> frames;
+        // frames of pages that are no longer fixed, reused by the next fixes
+        std::vector<std::unique_ptr<MmapBufferFrame>> spare_frames;
+    };
+
+    static constexpr size_t shard_count = 64;
+
+    const size_t page_size;
+
+    // bytes of address space mapped for every segment
+    const size_t reservation;
+
+    // segment id -> mapped segment, filled on first use
+    std::unique_ptr<std::atomic<Segment*>[]> segments;
+    // owns the segments, protected by `segments_latch`
+    std::vector<std::unique_ptr<Segment>> open_segments;
+    std::mutex segments_latch;
+
+    std::array<Shard, shard_count> shards;
+
+    /// Returns the mapped segment, opens and maps the file if needed.
+    Segment& get_segment(uint16_t segment_id);
+
+    /// Returns the address of the page in its segment's mapping, the file
+    /// is grown if it does not contain the page yet.
+    char* map_page(uint64_t page_id);
+
+  public:
+    MmapBufferManager(const MmapBufferManager&) = delete;
+    MmapBufferManager(MmapBufferManager&&) = delete;
+    MmapBufferManager& operator=(const MmapBufferManager&) = delete;
+    MmapBufferManager& operator=(MmapBufferManager&&) = delete;
+
+    /// Constructor.
+    /// @param[in] page_size   Size in bytes that all pages will have.
+    /// @param[in] page_count  Only there to match `BufferManager`, the
+    ///                        kernel decides how many pages stay in memory.
+    /// @param[in] reservation Bytes of address space mapped per segment, no
+    ///                        segment can grow beyond.
+    MmapBufferManager(size_t page_size, size_t page_count,
+                      size_t reservation = size_t{1} << 36);
+
+    /// Destructor. Unmaps the segments, the kernel writes their dirty pages
+    /// to disk.
+    ~MmapBufferManager();
+
+    /// Flushes the dirty pages of all segments to the device, so all
+    /// modifications of pages unfixed before the call are durable
+    /// afterwards.
+    void flush_all();
+
+    /// Returns size of a page
+    [[nodiscard]] size_t get_page_size() const { return page_size; }
+
+    /// Returns a reference to a `MmapBufferFrame` object for a given page id.
+    /// Pages that were never written read as zeros. Never throws
+    /// `buffer_full_error`, but `std::out_of_range` if the page lies beyond
+    /// the reservation of its segment.
+    /// Is thread-safe w.r.t. other concurrent calls to `fix_page()` and
+    /// `unfix_page()`.
+    /// @param[in] page_id   Page id of the page that should be loaded.
+    /// @param[in] exclusive If `exclusive` is true, the page is locked
+    ///                      exclusively. Otherwise it is locked
+    ///                      non-exclusively (shared).
+    MmapBufferFrame& fix_page(uint64_t page_id, bool exclusive);
+
+    /// Takes a `MmapBufferFrame` reference that was returned by an earlier
+    /// call to `fix_page()` and unfixes it. Modifications are written back by
+    /// the kernel whether `is_dirty` is set or not.
+    void unfix_page(MmapBufferFrame& page, bool is_dirty);
+
+    /// Returns the segment id for a given page id which is contained in the 16
+    /// most significant bits of the page id.
+    static constexpr uint16_t get_segment_id(uint64_t page_id) {
+        return page_id >> 48;
+    }
+
+    /// Returns the page id within its segment for a given page id. This
+    /// corresponds to the 48 least significant bits of the page id.
+    static constexpr uint64_t get_segment_page_id(uint64_t page_id) {
+        return page_id & ((1ull << 48) - 1);
+    }
+};
+
+} // namespace moderndbs
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef INCLUDE_MODERNDBS_NUMA_H
+#define INCLUDE_MODERNDBS_NUMA_H
+
+#include <cstddef>
+#include <vector>
+
+namespace moderndbs {
+
+/// The NUMA nodes of the machine as Linux reports them in sysfs. Nodes are
+/// numbered densely from 0 here, even if the kernel's node ids have gaps.
+/// On machines with a single node and on systems without NUMA support there
+/// is exactly one node, and placing memory or threads does nothing.
+class NumaTopology {
+  private:
+    // kernel node id of every node
+    std::vector<unsigned> node_ids;
+    // the CPUs of every node
+    std::vector<std::vector<unsigned>> node_cpus;
+    // CPU -> node, for CPUs that are not listed the node is 0
+    std::vector<unsigned> cpu_nodes;
+
+    NumaTopology();
+
+  public:
+    /// Returns the topology of the machine, read once.
+    [[nodiscard]] static const NumaTopology& get();
+
+    /// Returns the number of nodes, at least 1.
+    [[nodiscard]] size_t node_count() const { return node_ids.size(); }
+
+    /// Returns the node of the CPU the calling thread currently runs on.
+    [[nodiscard]] unsigned current_node() const;
+
+    /// Asks the kernel to place the physical memory of the pages overlapping
+    /// [`memory`, `memory` + `size`) on `node`. Memory that was already
+    /// touched stays where it is. The preference falls back to other nodes
+    /// when `node` runs out of memory. Returns false if the kernel does not
+    /// support it.
+    bool place_memory(void* memory, size_t size, unsigned node) const;
+
+    /// Restricts the calling thread to the CPUs of `node`. Returns false if
+    /// that failed.
+    bool pin_thread(unsigned node) const;
+};
+
+} // namespace moderndbs
+
+#endif
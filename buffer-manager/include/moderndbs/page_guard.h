@@ -0,0 +1,137 @@
+#ifndef INCLUDE_MODERNDBS_PAGE_GUARD_H
+#define INCLUDE_MODERNDBS_PAGE_GUARD_H
+
+#include "moderndbs/buffer_manager.h"
+#include <cstdint>
+
+namespace moderndbs {
+
+class ExclusivePageGuard;
+
+/// Keeps a page fixed and latched shared while it is alive and unfixes it
+/// afterwards. Move-only, a moved-from guard is empty.
+class SharedPageGuard {
+  private:
+    friend class ExclusivePageGuard;
+
+    BufferManager* buffer_manager = nullptr;
+    BufferFrame* frame = nullptr;
+
+    SharedPageGuard(BufferManager& buffer_manager, BufferFrame& frame);
+
+  public:
+    /// Creates an empty guard.
+    SharedPageGuard() = default;
+    /// Fixes the page with `AccessMode::Shared`, see
+    /// `BufferManager::fix_page()`.
+    SharedPageGuard(BufferManager& buffer_manager, uint64_t page_id);
+    SharedPageGuard(const SharedPageGuard&) = delete;
+    SharedPageGuard(SharedPageGuard&& other) noexcept;
+    SharedPageGuard& operator=(const SharedPageGuard&) = delete;
+    SharedPageGuard& operator=(SharedPageGuard&& other) noexcept;
+    ~SharedPageGuard();
+
+    /// Returns true if the guard holds a page.
+    explicit operator bool() const { return frame; }
+
+    [[nodiscard]] const char* get_data() const { return frame->get_data(); }
+
+    /// Unfixes the page, the guard is empty afterwards.
+    void release();
+
+    /// Latches the page exclusively without unfixing it and moves the fix
+    /// into the returned guard, this guard is empty afterwards. Everything
+    /// read under the shared latch stays valid. If another thread is
+    /// upgrading the page already, the returned guard is empty and this one
+    /// keeps the shared latch, see `BufferManager::upgrade_page()`.
+    ExclusivePageGuard try_upgrade();
+};
+
+/// Keeps a page fixed and latched exclusively while it is alive and unfixes
+/// it afterwards. The page is unfixed as dirty if it was accessed through
+/// the non-const `get_data()` or `mark_dirty()` was called. Move-only, a
+/// moved-from guard is empty.
+class ExclusivePageGuard {
+  private:
+    friend class SharedPageGuard;
+
+    BufferManager* buffer_manager = nullptr;
+    BufferFrame* frame = nullptr;
+    bool dirty = false;
+
+    ExclusivePageGuard(BufferManager& buffer_manager, BufferFrame& frame);
+
+  public:
+    /// Creates an empty guard.
+    ExclusivePageGuard() = default;
+    /// Fixes the page with `AccessMode::Exclusive`, see
+    /// `BufferManager::fix_page()`.
+    ExclusivePageGuard(BufferManager& buffer_manager, uint64_t page_id);
+    ExclusivePageGuard(const ExclusivePageGuard&) = delete;
+    ExclusivePageGuard(ExclusivePageGuard&& other) noexcept;
+    ExclusivePageGuard& operator=(const ExclusivePageGuard&) = delete;
+    ExclusivePageGuard& operator=(ExclusivePageGuard&& other) noexcept;
+    ~ExclusivePageGuard();
+
+    /// Returns true if the guard holds a page.
+    explicit operator bool() const { return frame; }
+
+    /// Returns the page for modification and marks it dirty.
+    [[nodiscard]] char* get_data() {
+        dirty = true;
+        return frame->get_data();
+    }
+
+    [[nodiscard]] const char* get_data() const { return frame->get_data(); }
+
+    /// Marks the page dirty without accessing it.
+    void mark_dirty() { dirty = true; }
+
+    /// Unfixes the page, the guard is empty afterwards.
+    void release();
+
+    /// Latches the page shared without unfixing it and moves the fix into
+    /// the returned guard, this guard is empty afterwards. Modifications made
+    /// so far are kept and no other writer can get in between.
+    SharedPageGuard downgrade();
+};
+
+/// Keeps a page fixed with `AccessMode::Optimistic` while it is alive and
+/// unfixes it afterwards. Reads have to be validated, see
+/// `BufferFrame::read_version()`. Move-only, a moved-from guard is empty.
+class OptimisticPageGuard {
+  private:
+    BufferManager* buffer_manager = nullptr;
+    BufferFrame* frame = nullptr;
+
+  public:
+    /// Creates an empty guard.
+    OptimisticPageGuard() = default;
+    /// Fixes the page with `AccessMode::Optimistic`.
+    OptimisticPageGuard(BufferManager& buffer_manager, uint64_t page_id);
+    OptimisticPageGuard(const OptimisticPageGuard&) = delete;
+    OptimisticPageGuard(OptimisticPageGuard&& other) noexcept;
+    OptimisticPageGuard& operator=(const OptimisticPageGuard&) = delete;
+    OptimisticPageGuard& operator=(OptimisticPageGuard&& other) noexcept;
+    ~OptimisticPageGuard();
+
+    /// Returns true if the guard holds a page.
+    explicit operator bool() const { return frame; }
+
+    [[nodiscard]] const char* get_data() const { return frame->get_data(); }
+
+    /// See `BufferFrame::read_version()`.
+    [[nodiscard]] uint64_t read_version() const { return frame->read_version(); }
+
+    /// See `BufferFrame::validate()`.
+    [[nodiscard]] bool validate(uint64_t version) const {
+        return frame->validate(version);
+    }
+
+    /// Unfixes the page, the guard is empty afterwards.
+    void release();
+};
+
+} // namespace moderndbs
+
+#endif
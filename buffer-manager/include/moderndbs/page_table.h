@@ -0,0 +1,56 @@
+#ifndef INCLUDE_MODERNDBS_PAGE_TABLE_H
+#define INCLUDE_MODERNDBS_PAGE_TABLE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+
+namespace moderndbs {
+
+/// Maps the ids of the resident pages of a buffer pool partition to the
+/// indexes of their frames. Open addressing with linear probing in a table
+/// that is allocated once for the maximum number of entries, deletions shift
+/// the following entries back instead of leaving tombstones. Modifications
+/// must be serialized, but `find()` may run concurrently with them.
+class PageTable {
+  private:
+    struct Entry {
+        std::atomic<uint64_t> page_id = 0;
+        // frame index + 1, 0 for an empty slot
+        std::atomic<uint32_t> frame = 0;
+    };
+
+    std::unique_ptr<Entry[]> entries;
+    // number of slots - 1, the number of slots is a power of two
+    size_t mask;
+
+    /// Returns the home slot of a page id.
+    [[nodiscard]] size_t home(uint64_t page_id) const;
+
+  public:
+    /// Returned by `find()` for pages that are not in the table.
+    static constexpr uint32_t not_found = std::numeric_limits<uint32_t>::max();
+
+    /// Constructor.
+    /// @param[in] capacity Maximum number of entries, the table keeps at
+    ///                     least half of its slots empty.
+    explicit PageTable(size_t capacity);
+
+    /// Returns the frame index of a page or `not_found`. Concurrently with a
+    /// modification, the result may be wrong: a page may not be found or
+    /// a frame index that belonged to the page at some time or to another
+    /// page may be returned. Callers have to validate it with the frame.
+    [[nodiscard]] uint32_t find(uint64_t page_id) const;
+
+    /// Adds a page which must not be in the table yet.
+    void insert(uint64_t page_id, uint32_t frame);
+
+    /// Removes a page which must be in the table.
+    void erase(uint64_t page_id);
+};
+
+} // namespace moderndbs
+
+#endif
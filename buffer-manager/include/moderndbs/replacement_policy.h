@@ -0,0 +1,86 @@
+#ifndef INCLUDE_MODERNDBS_REPLACEMENT_POLICY_H
+#define INCLUDE_MODERNDBS_REPLACEMENT_POLICY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace moderndbs {
+
+class BufferFrame;
+
+/// The page replacement strategies a `BufferManager` can be configured with.
+enum class ReplacementStrategy {
+    /// FIFO list for newly loaded pages, LRU list for pages that are loaded
+    /// again shortly after their eviction from the FIFO list.
+    TwoQ,
+    /// Second chance with a reference bit per frame, hits only set the bit.
+    Clock,
+    /// Evicts the page whose K-th most recent access is the oldest, pages
+    /// with less than K accesses first.
+    LruK,
+    /// Hits on hot pages cost nothing. Randomly chosen pages are moved to a
+    /// small FIFO cooling stage and evicted unless they are hit there.
+    Cooling
+};
+
+/// Decides which frame of a buffer pool partition is evicted next. Every
+/// partition owns its own policy and calls it with the partition latch held,
+/// so implementations do not need to synchronize, except for `on_hit()` if
+/// `concurrent_hits()` is true. Victims must be claimed with
+/// `BufferFrame::try_claim()`, which fails for fixed frames.
+class ReplacementPolicy {
+  public:
+    ReplacementPolicy() = default;
+    ReplacementPolicy(const ReplacementPolicy&) = delete;
+    ReplacementPolicy(ReplacementPolicy&&) = delete;
+    ReplacementPolicy& operator=(const ReplacementPolicy&) = delete;
+    ReplacementPolicy& operator=(ReplacementPolicy&&) = delete;
+    virtual ~ReplacementPolicy() = default;
+
+    /// Creates a policy for a partition with `page_count` frames.
+    /// @param[in] k The K of `ReplacementStrategy::LruK`, ignored otherwise.
+    static std::unique_ptr<ReplacementPolicy> create(ReplacementStrategy strategy, size_t page_count, size_t k);
+
+    /// A page was loaded into `frame`.
+    virtual void on_insert(BufferFrame& frame) = 0;
+
+    /// A resident page was fixed. Hits are reported without the partition
+    /// latch if `concurrent_hits()` is true. Otherwise they are only reported
+    /// when the latch is free, so under contention some hits are missed.
+    virtual void on_hit(BufferFrame& frame) = 0;
+
+    /// Returns true if `on_hit()` may be called concurrently with itself and
+    /// with all other methods.
+    [[nodiscard]] virtual bool concurrent_hits() const { return false; }
+
+    /// The page in `frame` is evicted, the frame is not passed to the policy
+    /// again unless it is inserted anew.
+    virtual void on_remove(BufferFrame& frame) = 0;
+
+    /// Claims and returns the frame that should be evicted next or nullptr if
+    /// all frames are fixed. Does not remove the frame, `on_remove()` is
+    /// called when it is actually evicted.
+    virtual BufferFrame* pick_victim() = 0;
+
+    /// Appends up to `count` unfixed frames in the order in which they are
+    /// expected to be evicted.
+    virtual void collect_victims(size_t count, std::vector<BufferFrame*>& victims) = 0;
+
+    /// Appends the page ids of the FIFO list in FIFO order. Policies without
+    /// such a list append nothing.
+    virtual void append_fifo_list(std::vector<uint64_t>& /*page_ids*/) const {}
+
+    /// Appends the page ids of the LRU list in LRU order. Policies without
+    /// such a list append nothing.
+    virtual void append_lru_list(std::vector<uint64_t>& /*page_ids*/) const {}
+
+    /// The partition was resized to `page_count` frames. Frames beyond the
+    /// new count are removed with `on_remove()` separately.
+    virtual void set_page_count(size_t /*page_count*/) {}
+};
+
+} // namespace moderndbs
+
+#endif
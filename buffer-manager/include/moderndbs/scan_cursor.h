@@ -0,0 +1,63 @@
+#ifndef INCLUDE_MODERNDBS_SCAN_CURSOR_H
+#define INCLUDE_MODERNDBS_SCAN_CURSOR_H
+
+#include "moderndbs/buffer_manager.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace moderndbs {
+
+/// Scans a range of pages of a segment in order. Pages that are not resident
+/// are loaded into a small ring of frames that the scan recycles, so a scan
+/// over a segment larger than the pool only displaces as many pages as the
+/// ring holds. Pages are fixed without influencing the replacement order
+/// and the next pages are read ahead asynchronously. Not thread-safe, but
+/// several cursors may scan concurrently with other users of the pool.
+class ScanCursor {
+  private:
+    BufferManager& buffer_manager;
+    const uint64_t segment_bits;
+    uint64_t next_page;
+    const uint64_t end_page;
+    const size_t read_ahead;
+
+    // pages before this one were already read ahead
+    uint64_t read_ahead_end;
+
+    // the page returned by the last call to `next()`
+    BufferFrame* current = nullptr;
+    uint64_t current_page = 0;
+
+    ScanRing ring;
+
+  public:
+    /// Constructor.
+    /// @param[in] segment_id The segment to scan.
+    /// @param[in] begin      The first segment page id to scan.
+    /// @param[in] end        The segment page id after the last one to scan.
+    /// @param[in] ring_size  Number of frames the scan recycles, must be
+    ///                       larger than `read_ahead`.
+    /// @param[in] read_ahead Number of pages read ahead of the current one.
+    ScanCursor(BufferManager& buffer_manager, uint16_t segment_id,
+               uint64_t begin, uint64_t end, size_t ring_size = 32,
+               size_t read_ahead = 8);
+    ScanCursor(const ScanCursor&) = delete;
+    ScanCursor(ScanCursor&&) = delete;
+    ScanCursor& operator=(const ScanCursor&) = delete;
+    ScanCursor& operator=(ScanCursor&&) = delete;
+
+    /// Unfixes the current page.
+    ~ScanCursor();
+
+    /// Unfixes the current page and fixes the next one shared. Returns its
+    /// data or nullptr at the end of the range. When the page cannot be
+    /// loaded because the buffer is full, throws `buffer_full_error`.
+    const char* next();
+
+    /// Returns the page id of the page returned by the last call to `next()`.
+    [[nodiscard]] uint64_t page_id() const;
+};
+
+} // namespace moderndbs
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef INCLUDE_MODERNDBS_SEGMENT_FILE_CACHE_H
+#define INCLUDE_MODERNDBS_SEGMENT_FILE_CACHE_H
+
+#include "moderndbs/file.h"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace moderndbs {
+
+/// Keeps the files of recently used segments open so that page I/O does not
+/// pay for opening and closing the segment file every time. At most
+/// `capacity` files are kept open, the least recently used idle file is
+/// closed when another one is needed.
+class SegmentFileCache {
+  private:
+    struct Entry {
+        std::shared_ptr<File> file;
+        // position in `lru`
+        std::list<uint16_t>::iterator lru_pos;
+    };
+
+    std::mutex latch;
+    std::unordered_map<uint16_t, Entry> files;
+
+    // segment ids of the open files, least recently used first
+    std::list<uint16_t> lru;
+
+    // segments that were written since the last `sync()`
+    std::unordered_set<uint16_t> written_segments;
+
+    const size_t capacity;
+    const File::IOMode io_mode;
+
+  public:
+    /// Constructor.
+    /// @param[in] capacity Maximum number of files kept open. With 0, files
+    ///                     are opened for every single call to `get()`.
+    /// @param[in] io_mode  `File::IOMode` the files are opened with.
+    explicit SegmentFileCache(size_t capacity, File::IOMode io_mode = File::SYNC);
+
+    /// Returns the file of the segment, opened in `WRITE` mode. The file may
+    /// be used concurrently by several threads for `read_block()` and
+    /// `write_block()` and stays open until the last user releases it, even
+    /// if the cache closes it in the meantime.
+    std::shared_ptr<File> get(uint16_t segment_id);
+
+    /// Remembers that the segment was written, so that the next `sync()`
+    /// flushes it.
+    void mark_written(uint16_t segment_id);
+
+    /// Flushes all segments written since the last call to the device.
+    void sync();
+};
+
+} // namespace moderndbs
+
+#endif
@@ -1,122 +1,1165 @@
 #include "moderndbs/buffer_manager.h"
 #include "moderndbs/file.h"
+#include "moderndbs/numa.h"
+#include <array>
+#include <bit>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+#include <stdexcept>
+#include <sys/mman.h>
 
 namespace moderndbs {
 
+void FrameLatch::wait(uint32_t current) {
+    // announce the sleeper first, so that the next release wakes it up
+    if (!(current & waiting) &&
+        !state.compare_exchange_strong(current, current | waiting,
+                                       std::memory_order_relaxed)) {
+        return;
+    }
+    state.wait(current | waiting, std::memory_order_relaxed);
+}
+
+void FrameLatch::lock_shared() {
+    auto current = state.load(std::memory_order_relaxed);
+    while (true) {
+        if (current & (exclusive | upgrading)) {
+            wait(current);
+            current = state.load(std::memory_order_relaxed);
+        } else if (state.compare_exchange_weak(current, current + 1,
+                                               std::memory_order_acquire,
+                                               std::memory_order_relaxed)) {
+            return;
+        }
+    }
+}
+
+bool FrameLatch::try_lock_shared() {
+    auto current = state.load(std::memory_order_relaxed);
+    while (!(current & (exclusive | upgrading))) {
+        if (state.compare_exchange_weak(current, current + 1,
+                                        std::memory_order_acquire,
+                                        std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void FrameLatch::unlock_shared() {
+    auto current = state.load(std::memory_order_relaxed);
+    uint32_t next = 0;
+    do {
+        // writers wait for the last reader, an upgrader for all but itself
+        next = current - 1;
+        if ((next & readers) <= 1) {
+            next &= ~waiting;
+        }
+    } while (!state.compare_exchange_weak(current, next,
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed));
+    if ((current & waiting) && !(next & waiting)) {
+        state.notify_all();
+    }
+}
+
+void FrameLatch::lock() {
+    auto current = state.load(std::memory_order_relaxed);
+    while (true) {
+        if (current & ~waiting) {
+            wait(current);
+            current = state.load(std::memory_order_relaxed);
+        } else if (state.compare_exchange_weak(current, current | exclusive,
+                                               std::memory_order_acquire,
+                                               std::memory_order_relaxed)) {
+            return;
+        }
+    }
+}
+
+bool FrameLatch::try_lock() {
+    uint32_t current = 0;
+    return state.compare_exchange_strong(current, exclusive,
+                                         std::memory_order_acquire,
+                                         std::memory_order_relaxed);
+}
+
+void FrameLatch::unlock() {
+    if (state.exchange(0, std::memory_order_release) & waiting) {
+        state.notify_all();
+    }
+}
+
+bool FrameLatch::try_upgrade() {
+    auto current = state.load(std::memory_order_relaxed);
+    do {
+        if (current & upgrading) {
+            return false;
+        }
+    } while (!state.compare_exchange_weak(current, current | upgrading,
+                                          std::memory_order_relaxed));
+    // new readers and writers are kept out now, wait for the other readers
+    current |= upgrading;
+    while (true) {
+        if ((current & readers) > 1) {
+            wait(current);
+            current = state.load(std::memory_order_relaxed);
+        } else if (state.compare_exchange_weak(current,
+                                               (current & waiting) | exclusive,
+                                               std::memory_order_acquire,
+                                               std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+}
+
+void FrameLatch::downgrade() {
+    if (state.exchange(1, std::memory_order_release) & waiting) {
+        state.notify_all();
+    }
+}
+
 char* BufferFrame::get_data() { return data; }
+const char* BufferFrame::get_data() const { return data; }
+
+uint64_t BufferFrame::read_version() const {
+    auto current = version.load(std::memory_order_acquire);
+    while (current & 1) {
+        std::this_thread::yield();
+        current = version.load(std::memory_order_acquire);
+    }
+    return current;
+}
+
+bool BufferFrame::validate(uint64_t version) const {
+    // the page reads must not be reordered after the version check
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return this->version.load(std::memory_order_relaxed) == version;
+}
+
+bool BufferFrame::try_pin() {
+    auto count = thread_cnt.load(std::memory_order_relaxed);
+    do {
+        if (count == unpinnable) {
+            return false;
+        }
+    } while (!thread_cnt.compare_exchange_weak(count, count + 1,
+                                               std::memory_order_acquire,
+                                               std::memory_order_relaxed));
+    return true;
+}
+
+bool BufferFrame::try_claim() {
+    size_t count = 0;
+    return thread_cnt.compare_exchange_strong(count, unpinnable,
+                                              std::memory_order_acquire,
+                                              std::memory_order_relaxed);
+}
 
 BufferFrame::BufferFrame(){};
 BufferFrame::BufferFrame(uint64_t page_id, char* data)
     : page_id(page_id), data(data) {}
 
-BufferManager::BufferManager(size_t page_size, size_t page_count)
-    : page_size(page_size), page_count(page_count),
-      buffer(std::make_unique<char[]>(page_count * page_size)) {}
+void FrameList::push_back(BufferFrame* frame) {
+    frame->prev = tail;
+    frame->next = nullptr;
+    if (tail) {
+        tail->next = frame;
+    } else {
+        head = frame;
+    }
+    tail = frame;
+    ++length;
+}
+
+void FrameList::insert_before(BufferFrame* position, BufferFrame* frame) {
+    frame->prev = position->prev;
+    frame->next = position;
+    if (position->prev) {
+        position->prev->next = frame;
+    } else {
+        head = frame;
+    }
+    position->prev = frame;
+    ++length;
+}
 
-BufferManager::~BufferManager() {
-    std::unique_lock<std::mutex> manager_lock(manager_latch);
-    for (auto& frame : bufferframes) {
-        write_back_to_disk(&frame.second, manager_lock);
-    }
-}
-
-BufferFrame& BufferManager::fix_page(uint64_t page_id, bool exclusive) {
-    // lock the whole buffet manager, when a thread is calling fix, others
-    // cannot change it
-    // std::lock_guard<std::mutex> manager_lock(manager_latch);
-    // manager_latch.lock();
-    std::unique_lock<std::mutex> manager_lock(manager_latch);
-    // first check if the page is in lru, if found return the frame
-    auto page_pos = std::find(lru.begin(), lru.end(), page_id);
-    if (page_pos != lru.end()) {
-        std::lock_guard<std::mutex> lru_lock(lru_latch);
-        bufferframes[page_id].thread_cnt++;
-        // If the page already in LRU, update it to the end of LRU
-        lru.erase(page_pos);
-        lru.push_back(page_id);
-        manager_lock.unlock();
-        return bufferframes[page_id];
+void FrameList::remove(BufferFrame* frame) {
+    if (frame->prev) {
+        frame->prev->next = frame->next;
     } else {
-        // second check if the page is in fifo, if found return the frame
-        auto pos = std::find(fifo.begin(), fifo.end(), page_id);
-        if (pos != fifo.end()) {
-            std::lock_guard<std::mutex> fifo_guard(fifo_latch);
-            std::lock_guard<std::mutex> lru_guard(lru_latch);
-            bufferframes[page_id].thread_cnt++;
-            lru.push_back(page_id);
-            fifo.erase(pos);
-            bufferframes[page_id].position = BufferFrame::LRU;
-            manager_lock.unlock();
-            return bufferframes[page_id];
-        } else {
-            // try to find a free slot in buffer
-            if (bufferframes.size() < page_count) {
-                // lock frame in exclusive mode
-                lock_frame(page_id, true);
-                // read frame from disk using frmae's meta data
-                read_frame(page_id, manager_lock);
-                // add frame to fifo queue
-                {
-                    std::lock_guard<std::mutex> fifo_guard(fifo_latch);
-                    bufferframes[page_id].position = BufferFrame::FIFO;
-                    fifo.push_back(page_id);
-                }
-                // unlock frame in exclusive mode
-                unlock_frame(page_id);
-                // lock frame in user's requested mode return the frame
-                lock_frame(page_id, exclusive);
-                manager_lock.unlock();
-                return bufferframes[page_id];
+        head = frame->next;
+    }
+    if (frame->next) {
+        frame->next->prev = frame->prev;
+    } else {
+        tail = frame->prev;
+    }
+    frame->prev = nullptr;
+    frame->next = nullptr;
+    --length;
+}
+
+void FrameList::move_to_back(BufferFrame* frame) {
+    if (frame == tail) {
+        return;
+    }
+    remove(frame);
+    push_back(frame);
+}
+
+namespace {
+
+/// Returns the `File::IOMode` that is actually used for the segment files.
+File::IOMode effective_io_mode(File::IOMode io_mode, size_t page_size) {
+    // direct I/O needs every transfer aligned to the logical block size,
+    // which is at most the 4 KiB a frame is guaranteed to be aligned to
+    if (io_mode == File::DIRECT && page_size % 4096 != 0) {
+        return File::BUFFERED;
+    }
+    return io_mode;
+}
+
+/// Size of the pages the kernel maps memory with by default.
+constexpr size_t small_page_size = 4096;
+
+/// Size of the huge pages of the pool, the default huge page size on x86-64
+/// and most ARM64 kernels.
+constexpr size_t huge_page_size = 2 << 20;
+
+/// Returns the physical memory of the `os_page_size` pages completely within
+/// [`begin`, `end`) to the operating system, they read as zeros afterwards.
+void release_memory(char* begin, char* end, size_t os_page_size) {
+    auto first = (reinterpret_cast<uintptr_t>(begin) + os_page_size - 1) /
+                 os_page_size * os_page_size;
+    auto last = reinterpret_cast<uintptr_t>(end) / os_page_size * os_page_size;
+    if (first < last) {
+        madvise(reinterpret_cast<void*>(first), last - first, MADV_DONTNEED);
+    }
+}
+
+/// Number of consecutive pages a thread has to fix before they are read
+/// ahead.
+constexpr size_t sequential_trigger = 4;
+
+/// Initial number of pages read ahead.
+constexpr size_t initial_read_ahead = 4;
+
+/// The sequential access of a thread to a segment.
+struct SequentialRun {
+    // `BufferManager::instance_id`, 0 for an unused run
+    uint64_t instance_id = 0;
+    uint16_t segment_id = 0;
+    uint64_t last_page = 0;
+    // number of consecutive pages fixed, ending with `last_page`
+    size_t length = 0;
+    // the pages before were read ahead
+    uint64_t read_ahead_end = 0;
+    size_t window = 0;
+};
+
+/// Sequential runs of the current thread, replaced round robin.
+thread_local std::array<SequentialRun, 4> sequential_runs;
+thread_local size_t next_sequential_run = 0;
+
+std::atomic<uint64_t> next_instance_id = 1;
+
+/// The statistics counters the current thread uses for the most recently
+/// used instances, by `BufferManager::instance_id`, replaced round robin.
+thread_local std::array<std::pair<uint64_t, ThreadCounters*>, 4> counter_cache;
+thread_local size_t next_counter_cache = 0;
+
+uint64_t elapsed_ns(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+} // namespace
+
+void BufferManager::PoolDeleter::operator()(char* memory) const {
+    munmap(memory, size);
+}
+
+std::unique_ptr<char[], BufferManager::PoolDeleter>
+BufferManager::allocate_pool(size_t size, bool huge_pages) {
+    if (huge_pages && size >= huge_page_size) {
+        // explicit huge pages are reserved up front, so the mapping fails
+        // unless enough of them are configured in /proc/sys/vm/nr_hugepages
+        size = (size + huge_page_size - 1) / huge_page_size * huge_page_size;
+        void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (memory != MAP_FAILED) {
+            return {static_cast<char*>(memory), PoolDeleter{size, huge_page_size}};
+        }
+    }
+    size = std::max((size + small_page_size - 1) / small_page_size *
+                        small_page_size,
+                    small_page_size);
+    size_t alignment = size >= huge_page_size ? huge_page_size : small_page_size;
+    // reserve enough to align the start and unmap the excess on both sides
+    size_t reserved = size + alignment - small_page_size;
+    void* memory = mmap(nullptr, reserved, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (memory == MAP_FAILED) {
+        throw std::bad_alloc{};
+    }
+    auto start = reinterpret_cast<uintptr_t>(memory);
+    auto aligned = (start + alignment - 1) / alignment * alignment;
+    if (aligned > start) {
+        munmap(memory, aligned - start);
+    }
+    if (start + reserved > aligned + size) {
+        munmap(reinterpret_cast<void*>(aligned + size),
+               start + reserved - aligned - size);
+    }
+    // the 2 MiB alignment lets the kernel back the pool with transparent
+    // huge pages, which it only does for madvised memory in its default
+    // configuration
+    madvise(reinterpret_cast<void*>(aligned), size,
+            huge_pages ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+    return {reinterpret_cast<char*>(aligned), PoolDeleter{size, small_page_size}};
+}
+
+size_t BufferManager::get_pool_page_size() const {
+    return buffer.get_deleter().page_size;
+}
+
+BufferManager::BufferManager(size_t page_size, size_t page_count,
+                             BufferManagerOptions options)
+    : buffer(allocate_pool(std::max(options.max_page_count, page_count) *
+                               page_size,
+                           options.huge_pages)),
+      page_size(page_size), page_count(page_count),
+      max_page_count(std::max(options.max_page_count, page_count)),
+      io_mode(effective_io_mode(options.io_mode, page_size)),
+      numa_nodes(options.numa_aware ? NumaTopology::get().node_count() : 1),
+      numa_chunk(std::max<size_t>((2 << 20) / std::max<size_t>(page_size, 1), 1)),
+      partition_count(std::clamp<size_t>(options.partition_count, 1,
+                                         std::max<size_t>(page_count, 1))),
+      segment_files(options.max_open_files, io_mode),
+      instance_id(next_instance_id.fetch_add(1)),
+      max_read_ahead(options.max_read_ahead),
+      max_write_pages(std::max<size_t>(options.max_write_pages, 1)),
+      log(options.log),
+      target_clean_ratio(std::clamp(options.target_clean_ratio, 0.0, 1.0)),
+      cleaner_interval(options.cleaner_interval),
+      cleaner_node(options.cleaner_node),
+      stats_interval(options.stats_interval),
+      stats_stream(options.stats_stream) {
+    // split the frames evenly, the first partitions get one more frame if
+    // page_count is not a multiple of the partition count. Every partition
+    // gets the frames and the memory for its share of max_page_count, so
+    // that resize() never has to move a frame.
+    auto share = [this](size_t count, size_t i) {
+        return count / partition_count + (i < count % partition_count);
+    };
+    partitions = std::make_unique<Partition[]>(partition_count);
+    size_t first_frame = 0;
+    for (size_t i = 0; i < partition_count; ++i) {
+        auto& partition = partitions[i];
+        partition.page_count = share(page_count, i);
+        partition.max_page_count = share(max_page_count, i);
+        partition.buffer = &buffer[first_frame * page_size];
+        partition.frames =
+            std::make_unique<BufferFrame[]>(partition.max_page_count);
+        partition.free_frames.resize(numa_nodes);
+        for (size_t j = partition.max_page_count; j-- > 0;) {
+            partition.frames[j].data = &partition.buffer[j * page_size];
+            if (j < partition.page_count) {
+                partition.free_frames[frame_node(j)].push_back(
+                    &partition.frames[j]);
+            }
+        }
+        // nothing touched the memory yet, so the placement applies to all of
+        // it
+        for (size_t j = 0; numa_nodes > 1 && j < partition.max_page_count;
+             j += numa_chunk) {
+            NumaTopology::get().place_memory(
+                &partition.buffer[j * page_size],
+                std::min(numa_chunk, partition.max_page_count - j) * page_size,
+                static_cast<unsigned>(frame_node(j)));
+        }
+        partition.page_table = PageTable(partition.max_page_count);
+        partition.policy = ReplacementPolicy::create(
+            options.replacement, partition.page_count, options.lru_k);
+        first_frame += partition.max_page_count;
+    }
+    if (log) {
+        recover();
+    }
+    if (target_clean_ratio > 0) {
+        page_cleaner = std::thread([this] { run_page_cleaner(); });
+    }
+    if (stats_interval.count() > 0 && stats_stream) {
+        stats_dumper = std::thread([this] { run_stats_dumper(); });
+    }
+}
+
+BufferManager::~BufferManager() {
+    {
+        std::lock_guard<std::mutex> cleaner_lock(cleaner_latch);
+        stop_threads = true;
+    }
+    cleaner_cv.notify_one();
+    stats_cv.notify_one();
+    if (page_cleaner.joinable()) {
+        page_cleaner.join();
+    }
+    if (stats_dumper.joinable()) {
+        stats_dumper.join();
+    }
+    // prefetches still write into the frames
+    for (auto reads = pending_reads->load(); reads > 0;
+         reads = pending_reads->load()) {
+        pending_reads->wait(reads);
+    }
+    flush_all();
+    if (log) {
+        // all pages are written, nothing has to be redone
+        log->set_redo_lsn(log->get_current_lsn());
+    }
+}
+
+void BufferManager::recover() {
+    log->redo([this](uint64_t page_id, uint32_t offset,
+                     std::span<const char> data, uint64_t lsn) {
+        if (offset + data.size() > page_size) {
+            throw std::runtime_error{"log record exceeds the page"};
+        }
+        auto& page = fix_page(page_id, AccessMode::Exclusive);
+        std::memcpy(page.data + offset, data.data(), data.size());
+        page.page_lsn.store(lsn, std::memory_order_relaxed);
+        unfix_page(page, true);
+    });
+}
+
+uint64_t BufferManager::log_update(BufferFrame& page, size_t offset,
+                                   size_t length) {
+    auto lsn = log->append(page.page_id, static_cast<uint32_t>(offset),
+                           {page.data + offset, length});
+    // the exclusive latch orders the LSNs of the page's records
+    page.page_lsn.store(lsn, std::memory_order_relaxed);
+    return lsn;
+}
+
+BufferManager::Partition& BufferManager::get_partition(uint64_t page_id) {
+    if (partition_count == 1) {
+        return partitions[0];
+    }
+    // consecutive pages of a segment should not end up in the same
+    // partition, so mix all bits of the page id before reducing it
+    uint64_t hash = page_id * 0x9e3779b97f4a7c15ull;
+    hash ^= hash >> 32;
+    return partitions[hash % partition_count];
+}
+
+BufferFrame* BufferManager::find_optimistic(uint64_t page_id,
+                                            uint64_t& version) {
+    auto& partition = get_partition(page_id);
+    while (true) {
+        auto index = partition.page_table.find(page_id);
+        if (index == PageTable::not_found) {
+            return nullptr;
+        }
+        // everything is only read, the version tells whether the frame held
+        // the page the whole time
+        auto& frame = partition.frames[index];
+        version = frame.version.load(std::memory_order_acquire);
+        if (frame.thread_cnt.load(std::memory_order_relaxed) ==
+                BufferFrame::unpinnable ||
+            frame.read_failed.load(std::memory_order_relaxed)) {
+            // the page is being evicted, the frame does not hold a page or
+            // the page has to be read again by a fix
+            return nullptr;
+        }
+        if (version & 1) {
+            // a writer holds the page or it is still being read
+            std::this_thread::yield();
+            continue;
+        }
+        if (frame.page_id.load(std::memory_order_relaxed) != page_id) {
+            return nullptr;
+        }
+        ThreadCounters::add(counters().hits);
+        return &frame;
+    }
+}
+
+void BufferManager::finish_read(BufferFrame& frame) {
+    // the frame is odd since its previous page was evicted
+    frame.version.fetch_add(1, std::memory_order_release);
+    frame.io_pending.store(false, std::memory_order_release);
+    frame.io_pending.notify_all();
+}
+
+BufferFrame* BufferManager::try_fix_resident(Partition& partition,
+                                             uint64_t page_id, bool touch) {
+    auto index = partition.page_table.find(page_id);
+    if (index == PageTable::not_found) {
+        return nullptr;
+    }
+    // the lookup raced with modifications of the page table or the frame was
+    // reassigned since, so check whether the pinned frame holds the page. The
+    // page id of a frame only changes while it cannot be pinned.
+    auto& frame = partition.frames[index];
+    if (!frame.try_pin()) {
+        return nullptr;
+    }
+    if (frame.page_id != page_id) {
+        unpin(partition, frame);
+        return nullptr;
+    }
+    if (!touch || take_prefetched(frame)) {
+        // scans do not influence the replacement order, and the first fix of
+        // a prefetched page is the first reference the policy should see
+    } else if (partition.policy->concurrent_hits()) {
+        partition.policy->on_hit(frame);
+    } else if (std::unique_lock<std::mutex> partition_lock(partition.latch,
+                                                           std::try_to_lock);
+               partition_lock) {
+        // the replacement order is only a heuristic, rather lose the hit
+        // than wait for the latch
+        partition.policy->on_hit(frame);
+    }
+    ThreadCounters::add(counters().hits);
+    return &frame;
+}
+
+BufferFrame& BufferManager::fix_page(uint64_t page_id, AccessMode mode) {
+    auto& partition = get_partition(page_id);
+    // optimistic readers only keep the page resident, they do not count as
+    // references
+    const bool touch = mode != AccessMode::Optimistic;
+    auto* frame = try_fix_resident(partition, page_id, touch);
+    if (!frame) {
+        // lock the partition, when a thread is calling fix, others cannot
+        // change it
+        std::unique_lock<std::mutex> partition_lock(partition.latch,
+                                                    std::defer_lock);
+        lock_partition(partition_lock);
+        frame = fix_locked(partition, page_id, partition_lock, nullptr, touch);
+        if (!frame) {
+            // no page can be evicted, throw an error
+            throw buffer_full_error{};
+        }
+    }
+    if (max_read_ahead > 0) {
+        // the page is fixed, so the read-ahead cannot evict it
+        read_ahead(page_id);
+    }
+    // the fix count keeps the frame from being evicted
+    lock_frame(*frame, mode);
+    return *frame;
+}
+
+BufferFrame* BufferManager::fix_page_wait(
+    uint64_t page_id, AccessMode mode,
+    std::chrono::steady_clock::time_point deadline) {
+    auto& partition = get_partition(page_id);
+    const bool touch = mode != AccessMode::Optimistic;
+    auto* frame = try_fix_resident(partition, page_id, touch);
+    std::unique_lock<std::mutex> partition_lock(partition.latch,
+                                                std::defer_lock);
+    if (!frame) {
+        lock_partition(partition_lock);
+        frame = fix_locked(partition, page_id, partition_lock, nullptr, touch);
+    }
+    if (!frame) {
+        auto wait_start = std::chrono::steady_clock::now();
+        // announce the waiter before looking for a victim again, so that an
+        // unfix either sees the waiter or is seen by the retry
+        partition.waiters.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool timed_out = false;
+        while (!(frame = fix_locked(partition, page_id, partition_lock,
+                                    nullptr, touch)) &&
+               !timed_out) {
+            if (deadline == std::chrono::steady_clock::time_point::max()) {
+                partition.frame_unfixed.wait(partition_lock);
             } else {
-                // bufferframes is full, try to evict one from fifo or lru
-                auto free_frame = evict_check();
-                if (free_frame) {
-                    // can evict a frame from fifo, lru
-                    // evict the frame nobody use
-                    auto free_frame_pos = free_frame->position;
-                    evict(free_frame, manager_lock);
-                    // lock frame in exclusive mode
-                    lock_frame(page_id, true);
-                    // read frame from disk using frmae's meta data
-                    read_frame(page_id, manager_lock);
-                    // add frame to fifo/lru queue
-                    if (free_frame_pos == BufferFrame::FIFO) {
-                        std::lock_guard<std::mutex> fifo_guard(fifo_latch);
-                        bufferframes[page_id].position = BufferFrame::FIFO;
-                        fifo.push_back(page_id);
-                    } else {
-                        std::lock_guard<std::mutex> lru_guard(lru_latch);
-                        bufferframes[page_id].position = BufferFrame::LRU;
-                        lru.push_back(page_id);
-                    }
-
-                    // unlock frame in exclusive mode
-                    unlock_frame(page_id);
-                    // lock frame in user's requested mode return the frame
-                    lock_frame(page_id, exclusive);
-                    manager_lock.unlock();
-                    return bufferframes[page_id];
-                } else {
-                    // no page can be evicted, throw an error
-                    throw buffer_full_error{};
+                timed_out = partition.frame_unfixed.wait_until(
+                                partition_lock, deadline) ==
+                            std::cv_status::timeout;
+            }
+        }
+        partition.waiters.fetch_sub(1);
+        auto& thread_counters = counters();
+        ThreadCounters::add(thread_counters.waits);
+        ThreadCounters::add(thread_counters.wait_time, elapsed_ns(wait_start));
+        if (!frame) {
+            ThreadCounters::add(thread_counters.timeouts);
+            return nullptr;
+        }
+    }
+    if (max_read_ahead > 0) {
+        read_ahead(page_id);
+    }
+    lock_frame(*frame, mode);
+    return frame;
+}
+
+std::vector<BufferFrame*>
+BufferManager::fix_pages(std::span<const uint64_t> page_ids, AccessMode mode) {
+    // every page is fixed and latched once, in page id order, so that the
+    // batches of concurrent callers cannot deadlock. `positions` remembers
+    // where the pages go in the result.
+    std::vector<std::pair<uint64_t, size_t>> positions(page_ids.size());
+    for (size_t i = 0; i < page_ids.size(); ++i) {
+        positions[i] = {page_ids[i], i};
+    }
+    std::sort(positions.begin(), positions.end());
+    std::vector<uint64_t> distinct;
+    distinct.reserve(positions.size());
+    for (const auto& [page_id, position] : positions) {
+        if (distinct.empty() || distinct.back() != page_id) {
+            distinct.push_back(page_id);
+        }
+    }
+    // resident pages are fixed without any partition latch like in
+    // fix_page(), the others are fixed partition by partition, so that
+    // every partition latch is acquired once
+    const bool touch = mode != AccessMode::Optimistic;
+    std::vector<Partition*> page_partitions(distinct.size());
+    std::vector<BufferFrame*> frames(distinct.size());
+    std::vector<size_t> order;
+    for (size_t i = 0; i < distinct.size(); ++i) {
+        page_partitions[i] = &get_partition(distinct[i]);
+        frames[i] = try_fix_resident(*page_partitions[i], distinct[i], touch);
+        if (!frames[i]) {
+            order.push_back(i);
+        }
+    }
+    if (partition_count > 1) {
+        std::stable_sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+            return page_partitions[lhs] < page_partitions[rhs];
+        });
+    }
+
+    std::vector<size_t> missed;
+    bool full = false;
+    std::exception_ptr error;
+    const auto miss_start = std::chrono::steady_clock::now();
+    auto& thread_counters = counters();
+    for (size_t begin = 0; begin < order.size() && !full && !error;) {
+        auto& partition = *page_partitions[order[begin]];
+        std::unique_lock<std::mutex> partition_lock(partition.latch,
+                                                    std::defer_lock);
+        lock_partition(partition_lock);
+        for (; begin < order.size() && page_partitions[order[begin]] == &partition;
+             ++begin) {
+            auto i = order[begin];
+            // the page may have been loaded since
+            if (auto* frame = pin_resident(partition, distinct[i], partition_lock)) {
+                if (touch && !take_prefetched(*frame)) {
+                    partition.policy->on_hit(*frame);
                 }
+                ThreadCounters::add(thread_counters.hits);
+                frames[i] = frame;
+                continue;
+            }
+            try {
+                frames[i] = allocate_frame(partition, distinct[i]);
+            } catch (...) {
+                // writing back a dirty victim failed
+                error = std::current_exception();
+                break;
+            }
+            if (!frames[i]) {
+                full = true;
+                break;
+            }
+            missed.push_back(i);
+        }
+    }
+    if (full || error) {
+        // the batch fails anyway, so its frames are given back without
+        // reading their pages, unless concurrent fixes of a page wait for it
+        std::erase_if(missed, [&](size_t i) {
+            auto& partition = *page_partitions[i];
+            std::unique_lock<std::mutex> partition_lock(partition.latch,
+                                                        std::defer_lock);
+            lock_partition(partition_lock);
+            if (!discard_frame(partition, *frames[i])) {
+                return false;
+            }
+            frames[i] = nullptr;
+            return true;
+        });
+    }
+
+    // concurrent fixes of the missed pages wait for io_pending
+    std::vector<BufferFrame*> missed_frames(missed.size());
+    for (size_t j = 0; j < missed.size(); ++j) {
+        missed_frames[j] = frames[missed[j]];
+    }
+    auto read_errors = read_frames(missed_frames);
+    for (size_t j = 0; j < missed.size(); ++j) {
+        if (!read_errors[j]) {
+            finish_read(*missed_frames[j]);
+            continue;
+        }
+        if (!error) {
+            error = read_errors[j];
+        }
+        auto& partition = *page_partitions[missed[j]];
+        std::unique_lock<std::mutex> partition_lock(partition.latch,
+                                                    std::defer_lock);
+        lock_partition(partition_lock);
+        // releases the fix
+        fail_read(partition, *missed_frames[j]);
+        frames[missed[j]] = nullptr;
+    }
+    ThreadCounters::add(thread_counters.misses, missed.size());
+    auto bucket = std::min<size_t>(std::bit_width(elapsed_ns(miss_start)),
+                                   ThreadCounters::latency_buckets - 1);
+    ThreadCounters::add(thread_counters.miss_latency[bucket], missed.size());
+    if (full || error) {
+        for (size_t i = 0; i < distinct.size(); ++i) {
+            if (frames[i]) {
+                unpin(*page_partitions[i], *frames[i]);
+            }
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        throw buffer_full_error{};
+    }
+
+    // prefetches of resident pages may still be in flight, the pages are
+    // only latched once all of them are read
+    std::exception_ptr read_error;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        try {
+            wait_for_read(*frames[i]);
+        } catch (...) {
+            // the fix is released already
+            frames[i] = nullptr;
+            if (!read_error) {
+                read_error = std::current_exception();
+            }
+        }
+    }
+    if (read_error) {
+        for (size_t i = 0; i < frames.size(); ++i) {
+            if (frames[i]) {
+                unpin(*page_partitions[i], *frames[i]);
             }
         }
+        std::rethrow_exception(read_error);
+    }
+    for (auto* frame : frames) {
+        lock_frame(*frame, mode);
+    }
+    std::vector<BufferFrame*> result(page_ids.size());
+    for (size_t i = 0, j = 0; i < positions.size(); ++i) {
+        j += positions[i].first != distinct[j];
+        result[positions[i].second] = frames[j];
+    }
+    return result;
+}
+
+void BufferManager::unfix_pages(std::span<BufferFrame* const> pages,
+                                bool is_dirty) {
+    std::vector<BufferFrame*> distinct(pages.begin(), pages.end());
+    std::sort(distinct.begin(), distinct.end());
+    distinct.erase(std::unique(distinct.begin(), distinct.end()),
+                   distinct.end());
+    for (auto* page : distinct) {
+        unfix_page(*page, is_dirty);
     }
 }
 
+BufferFrame* BufferManager::pin_resident(
+    Partition& partition, uint64_t page_id,
+    std::unique_lock<std::mutex>& partition_lock) {
+    while (true) {
+        auto index = partition.page_table.find(page_id);
+        if (index == PageTable::not_found) {
+            return nullptr;
+        }
+        auto& frame = partition.frames[index];
+        if (frame.try_pin()) {
+            return &frame;
+        }
+        // claimed by an eviction, which either drops the page or releases
+        // the claim if the write back fails. The partition is not full, so
+        // look the page up again once that happened.
+        partition_lock.unlock();
+        std::this_thread::yield();
+        lock_partition(partition_lock);
+    }
+}
+
+BufferFrame* BufferManager::fix_locked(
+    Partition& partition, uint64_t page_id,
+    std::unique_lock<std::mutex>& partition_lock, ScanRing* ring, bool touch) {
+    if (auto* frame = pin_resident(partition, page_id, partition_lock)) {
+        if (touch && !ring && !take_prefetched(*frame)) {
+            partition.policy->on_hit(*frame);
+        }
+        ThreadCounters::add(counters().hits);
+        // the fix count keeps the frame from being evicted, so the latch can
+        // be waited for without blocking the whole partition
+        partition_lock.unlock();
+        return frame;
+    }
+
+    auto miss_start = std::chrono::steady_clock::now();
+    auto* frame = allocate_frame(partition, page_id, ring);
+    if (!frame) {
+        return nullptr;
+    }
+    // read frame from disk using frame's meta data, concurrent fixes of the
+    // page wait for io_pending
+    try {
+        read_frame(*frame);
+    } catch (...) {
+        // the page must not stay resident with whatever was read, the next
+        // fix reads it again
+        fail_read(partition, *frame);
+        throw;
+    }
+    finish_read(*frame);
+    // only threads that fixed the page while it was read can know the frame
+    partition_lock.unlock();
+    auto& thread_counters = counters();
+    ThreadCounters::add(thread_counters.misses);
+    auto bucket = std::min<size_t>(std::bit_width(elapsed_ns(miss_start)),
+                                   ThreadCounters::latency_buckets - 1);
+    ThreadCounters::add(thread_counters.miss_latency[bucket]);
+    return frame;
+}
+
+void BufferManager::unpin(Partition& partition, BufferFrame& frame) {
+    if (frame.thread_cnt.fetch_sub(1) == 1 && partition.waiters.load() > 0) {
+        // the waiter may be between its retry and its wait, which it only
+        // does with the latch held
+        std::lock_guard<std::mutex> partition_lock(partition.latch);
+        partition.frame_unfixed.notify_all();
+    }
+}
+
+void BufferManager::unpin_locked(Partition& partition, BufferFrame& frame) {
+    // the latch is held, so waiters cannot miss the notification
+    if (frame.thread_cnt.fetch_sub(1) == 1 && partition.waiters.load() > 0) {
+        partition.frame_unfixed.notify_all();
+    }
+}
+
+bool BufferManager::take_prefetched(BufferFrame& frame) {
+    // only write the frame's cache line for the first fix
+    if (frame.prefetched.load(std::memory_order_relaxed) &&
+        frame.prefetched.exchange(false, std::memory_order_relaxed)) {
+        ThreadCounters::add(counters().prefetches_used);
+        return true;
+    }
+    return false;
+}
+
+void BufferManager::read_ahead(uint64_t page_id) noexcept {
+    const auto segment_id = get_segment_id(page_id);
+    const auto page = get_segment_page_id(page_id);
+    SequentialRun* run = nullptr;
+    for (auto& candidate : sequential_runs) {
+        if (candidate.instance_id == instance_id &&
+            candidate.segment_id == segment_id) {
+            run = &candidate;
+        }
+    }
+    if (!run) {
+        run = &sequential_runs[next_sequential_run];
+        next_sequential_run = (next_sequential_run + 1) % sequential_runs.size();
+        *run = {instance_id, segment_id, page, 1, page + 1, 0};
+        return;
+    }
+    if (page == run->last_page + 1) {
+        ++run->length;
+    } else if (page != run->last_page) {
+        // not sequential (anymore), start over
+        *run = {instance_id, segment_id, page, 1, page + 1, 0};
+        return;
+    }
+    run->last_page = page;
+    if (run->length < sequential_trigger) {
+        return;
+    }
+    // read the next window once the thread got within half a window of the
+    // end of the pages read ahead so far, so the reads stay ahead of it
+    if (run->window > 0 && page + run->window / 2 < run->read_ahead_end) {
+        return;
+    }
+    run->window = std::min(
+        max_read_ahead, run->window > 0 ? 2 * run->window : initial_read_ahead);
+    // the read-ahead is only a hint, the caller holds a fix that must not
+    // leak, so errors are left to the fixes of these pages
+    try {
+        // the cached handle's size() does not grow with the pages written
+        // back through it, so ask the file system
+        auto file = segment_files.get(segment_id);
+        auto end =
+            std::min(page + 1 + run->window, file->read_size() / page_size);
+        for (auto next_page = std::max(run->read_ahead_end, page + 1);
+             next_page < end; ++next_page) {
+            prefetch_page((uint64_t{segment_id} << 48) | next_page, nullptr);
+        }
+        run->read_ahead_end = std::max(run->read_ahead_end, end);
+    } catch (...) {
+    }
+}
+
+BufferFrame* BufferManager::take_ring_frame(Partition& partition,
+                                            ScanRing& ring) {
+    if (ring.slots.size() < ring.capacity) {
+        // the ring is still filling up
+        return nullptr;
+    }
+    auto* frames_end = partition.frames.get() + partition.page_count;
+    for (auto it = ring.slots.begin(); it != ring.slots.end(); ++it) {
+        auto* frame = it->frame;
+        // with several partitions only some frames of the ring can hold the
+        // page. Page ids of the partition's frames only change under its
+        // latch, so an unchanged page id means that the scan's page is still
+        // there.
+        if (frame < partition.frames.get() || frame >= frames_end ||
+            frame->page_id.load(std::memory_order_relaxed) != it->page_id ||
+            !frame->try_claim()) {
+            continue;
+        }
+        ring.slots.erase(it);
+        return frame;
+    }
+    return nullptr;
+}
+
+BufferFrame* BufferManager::take_free_frame(Partition& partition) {
+    // frames of the local node first, then those of the other nodes
+    size_t local = numa_nodes > 1 ? NumaTopology::get().current_node() : 0;
+    for (size_t i = 0; i < numa_nodes; ++i) {
+        auto& free_frames = partition.free_frames[(local + i) % numa_nodes];
+        if (!free_frames.empty()) {
+            auto* frame = free_frames.back();
+            free_frames.pop_back();
+            return frame;
+        }
+    }
+    return nullptr;
+}
+
+BufferFrame* BufferManager::allocate_frame(Partition& partition,
+                                           uint64_t page_id, ScanRing* ring) {
+    BufferFrame* frame = ring ? take_ring_frame(partition, *ring) : nullptr;
+    if (frame) {
+        evict(partition, frame);
+    } else if (!(frame = take_free_frame(partition))) {
+        // all frames hold a page, let the policy choose a victim
+        frame = partition.policy->pick_victim();
+        // frames beyond the page count still hold pages while a shrinking
+        // resize() waits for other frames, they are retired instead of reused
+        while (frame && frame >= partition.frames.get() + partition.page_count) {
+            evict(partition, frame);
+            frame = partition.policy->pick_victim();
+        }
+        if (!frame) {
+            return nullptr;
+        }
+        if (page_cleaner.joinable() && frame->state == BufferFrame::DIRTY) {
+            // the cleaner did not keep up, let it start its next round now
+            cleaner_cv.notify_one();
+        }
+        evict(partition, frame);
+    }
+
+    if (!(frame->version.load(std::memory_order_relaxed) & 1)) {
+        // a free frame that never held a page or whose page was discarded
+        frame->version.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+    frame->page_id.store(page_id, std::memory_order_relaxed);
+    frame->state = BufferFrame::NEW;
+    frame->io_pending.store(true, std::memory_order_relaxed);
+    frame->read_failed.store(false, std::memory_order_relaxed);
+    frame->page_lsn.store(0, std::memory_order_relaxed);
+    partition.page_table.insert(
+        page_id, static_cast<uint32_t>(frame - partition.frames.get()));
+    partition.policy->on_insert(*frame);
+    // publish the new page id to threads that pin the frame without latch
+    frame->thread_cnt.store(1, std::memory_order_release);
+    if (ring) {
+        ring->slots.push_back({frame, page_id});
+        if (ring->slots.size() > ring->capacity) {
+            // the oldest page stays in the pool as a regular page
+            ring->slots.erase(ring->slots.begin());
+        }
+    }
+    return frame;
+}
+
+bool BufferManager::discard_frame(Partition& partition, BufferFrame& frame) {
+    size_t count = 1;
+    if (!frame.thread_cnt.compare_exchange_strong(count, BufferFrame::unpinnable,
+                                                  std::memory_order_acquire,
+                                                  std::memory_order_relaxed)) {
+        return false;
+    }
+    partition.policy->on_remove(frame);
+    partition.page_table.erase(frame.page_id);
+    frame.io_pending.store(false, std::memory_order_relaxed);
+    // a frame beyond the page count was retired by a shrinking resize()
+    // while it was fixed, it stays unpinnable without a page
+    auto index = static_cast<size_t>(&frame - partition.frames.get());
+    if (index < partition.page_count) {
+        partition.free_frames[frame_node(index)].push_back(&frame);
+    }
+    if (partition.waiters.load() > 0) {
+        partition.frame_unfixed.notify_all();
+    }
+    return true;
+}
+
+void BufferManager::fail_read(Partition& partition, BufferFrame& frame) {
+    if (discard_frame(partition, frame)) {
+        return;
+    }
+    // the version stays odd until the page was read again
+    frame.read_failed.store(true, std::memory_order_relaxed);
+    frame.io_pending.store(false, std::memory_order_release);
+    frame.io_pending.notify_all();
+    unpin_locked(partition, frame);
+}
+
+void BufferManager::wait_for_read(BufferFrame& frame) {
+    frame.io_pending.wait(true, std::memory_order_acquire);
+    if (!frame.read_failed.load(std::memory_order_acquire)) {
+        return;
+    }
+    // the page is read like on a miss, with the partition latch held, so
+    // that only the first thread that waited for it reads it
+    auto& partition = get_partition(frame.page_id);
+    std::unique_lock<std::mutex> partition_lock(partition.latch,
+                                                std::defer_lock);
+    lock_partition(partition_lock);
+    if (!frame.read_failed.load(std::memory_order_relaxed)) {
+        return;
+    }
+    try {
+        read_frame(frame);
+    } catch (...) {
+        unpin_locked(partition, frame);
+        throw;
+    }
+    frame.version.fetch_add(1, std::memory_order_release);
+    frame.read_failed.store(false, std::memory_order_release);
+}
+
+void BufferManager::prefetch(std::span<const uint64_t> page_ids) {
+    for (auto page_id : page_ids) {
+        prefetch_page(page_id, nullptr);
+    }
+}
+
+void BufferManager::prefetch_page(uint64_t page_id, ScanRing* ring) {
+    auto& partition = get_partition(page_id);
+    // opened before a frame is taken, so that there is nothing to undo if it
+    // fails
+    auto file = segment_files.get(get_segment_id(page_id));
+    std::unique_lock<std::mutex> partition_lock(partition.latch,
+                                                std::defer_lock);
+    lock_partition(partition_lock);
+    if (partition.page_table.find(page_id) != PageTable::not_found) {
+        return;
+    }
+    auto* frame = allocate_frame(partition, page_id, ring);
+    if (!frame) {
+        // prefetching is only a hint, just skip the page
+        return;
+    }
+    // the frame stays fixed until the read finished, fixes of the page
+    // meanwhile wait for the read
+    frame->prefetched.store(true, std::memory_order_relaxed);
+    ThreadCounters::add(counters().prefetches_issued);
+    ++*pending_reads;
+    partition_lock.unlock();
+
+    std::memset(frame->data, 0, page_size);
+    file->read_block_async(
+        get_segment_page_id(page_id) * page_size, page_size, frame->data,
+        [this, &partition, frame, file, pending = pending_reads](int error) {
+            if (error) {
+                // no I/O on the completion thread, the page is read again by
+                // the next fix
+                std::lock_guard<std::mutex> partition_lock(partition.latch);
+                fail_read(partition, *frame);
+            } else {
+                finish_read(*frame);
+                unpin(partition, *frame);
+            }
+            // the buffer manager may be gone once the count dropped
+            if (pending->fetch_sub(1) == 1) {
+                pending->notify_all();
+            }
+        });
+}
+
+BufferFrame& BufferManager::fix_scan_page(uint64_t page_id, ScanRing& ring) {
+    auto& partition = get_partition(page_id);
+    if (auto* frame = try_fix_resident(partition, page_id, false)) {
+        lock_frame(*frame, AccessMode::Shared);
+        return *frame;
+    }
+    std::unique_lock<std::mutex> partition_lock(partition.latch,
+                                                std::defer_lock);
+    lock_partition(partition_lock);
+    auto* frame = fix_locked(partition, page_id, partition_lock, &ring);
+    if (!frame) {
+        throw buffer_full_error{};
+    }
+    lock_frame(*frame, AccessMode::Shared);
+    return *frame;
+}
+
 void BufferManager::unfix_page(BufferFrame& page, bool is_dirty) {
-    page.frame_latch.unlock();
     if (is_dirty) {
         page.state = BufferFrame::DIRTY;
     }
-    page.thread_cnt--;
+    // an odd version means that the frame is latched exclusively, which can
+    // only be the caller as shared holders exclude writers
+    if (page.version.load(std::memory_order_relaxed) & 1) {
+        page.version.fetch_add(1, std::memory_order_release);
+        page.frame_latch.unlock();
+    } else {
+        page.frame_latch.unlock_shared();
+    }
+    unpin(get_partition(page.page_id), page);
+}
+
+bool BufferManager::upgrade_page(BufferFrame& page) {
+    if (!page.frame_latch.try_upgrade()) {
+        return false;
+    }
+    // make the version odd before the page is modified, see `lock_frame()`
+    page.version.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    return true;
+}
+
+void BufferManager::downgrade_page(BufferFrame& page, bool is_dirty) {
+    if (is_dirty) {
+        page.state = BufferFrame::DIRTY;
+    }
+    page.version.fetch_add(1, std::memory_order_release);
+    page.frame_latch.downgrade();
+}
+
+void BufferManager::unfix_optimistic(BufferFrame& page) {
+    unpin(get_partition(page.page_id), page);
 }
 
 std::vector<uint64_t> BufferManager::get_fifo_list() const {
     std::vector<uint64_t> fifo_list;
-    for (auto& page_id : fifo) {
-        fifo_list.push_back(page_id);
+    for (size_t i = 0; i < partition_count; ++i) {
+        partitions[i].policy->append_fifo_list(fifo_list);
     }
 
     return fifo_list;
@@ -124,100 +1167,761 @@ std::vector<uint64_t> BufferManager::get_fifo_list() const {
 
 std::vector<uint64_t> BufferManager::get_lru_list() const {
     std::vector<uint64_t> lru_list;
-    for (auto& page_id : lru) {
-        lru_list.push_back(page_id);
+    for (size_t i = 0; i < partition_count; ++i) {
+        partitions[i].policy->append_lru_list(lru_list);
     }
 
     return lru_list;
 }
 
-BufferFrame* BufferManager::evict_check() {
-    // first check the fifo queue
-    for (auto const& page_id : fifo) {
-        if (bufferframes[page_id].thread_cnt == 0) {
-            return &bufferframes[page_id];
+ThreadCounters& BufferManager::counters() {
+    for (auto& [id, thread_counters] : counter_cache) {
+        if (id == instance_id) {
+            return *thread_counters;
+        }
+    }
+    ThreadCounters* thread_counters = nullptr;
+    {
+        // the thread may have used the instance before it was evicted from
+        // the cache
+        std::lock_guard<std::mutex> counters_lock(counters_latch);
+        auto self = std::this_thread::get_id();
+        for (auto& candidate : all_counters) {
+            if (candidate->owner == self) {
+                thread_counters = candidate.get();
+            }
+        }
+        if (!thread_counters) {
+            thread_counters =
+                all_counters.emplace_back(std::make_unique<ThreadCounters>()).get();
+            thread_counters->owner = self;
         }
     }
+    counter_cache[next_counter_cache] = {instance_id, thread_counters};
+    next_counter_cache = (next_counter_cache + 1) % counter_cache.size();
+    return *thread_counters;
+}
 
-    // second check the lru queue
-    for (auto const& page_id : lru) {
-        if (bufferframes[page_id].thread_cnt == 0) {
-            return &bufferframes[page_id];
+void BufferManager::sum_counters(ThreadCounters& sum) const {
+    auto add = [](std::atomic<uint64_t>& total,
+                  const std::atomic<uint64_t>& counter) {
+        ThreadCounters::add(total, counter.load(std::memory_order_relaxed));
+    };
+    std::lock_guard<std::mutex> counters_lock(counters_latch);
+    for (const auto& thread_counters : all_counters) {
+        add(sum.hits, thread_counters->hits);
+        add(sum.misses, thread_counters->misses);
+        add(sum.evictions, thread_counters->evictions);
+        add(sum.dirty_writes, thread_counters->dirty_writes);
+        add(sum.write_requests, thread_counters->write_requests);
+        add(sum.latch_waits, thread_counters->latch_waits);
+        add(sum.latch_wait_time, thread_counters->latch_wait_time);
+        add(sum.waits, thread_counters->waits);
+        add(sum.timeouts, thread_counters->timeouts);
+        add(sum.wait_time, thread_counters->wait_time);
+        add(sum.prefetches_issued, thread_counters->prefetches_issued);
+        add(sum.prefetches_used, thread_counters->prefetches_used);
+        add(sum.prefetches_wasted, thread_counters->prefetches_wasted);
+        for (size_t i = 0; i < ThreadCounters::latency_buckets; ++i) {
+            add(sum.miss_latency[i], thread_counters->miss_latency[i]);
         }
     }
-    return nullptr;
 }
 
-void BufferManager::evict(BufferFrame* evict_frame,
-                          std::unique_lock<std::mutex>& manager_lock) {
-    auto evict_id = evict_frame->page_id;
-    if (evict_frame->state == BufferFrame::DIRTY) {
-        write_back_to_disk(evict_frame, manager_lock);
+BufferManager::Stats BufferManager::stats() const {
+    ThreadCounters sum;
+    sum_counters(sum);
+    Stats stats;
+    stats.hits = sum.hits;
+    stats.misses = sum.misses;
+    stats.evictions = sum.evictions;
+    stats.dirty_writes = sum.dirty_writes;
+    stats.write_requests = sum.write_requests;
+    stats.latch_waits = sum.latch_waits;
+    stats.latch_wait_time = std::chrono::nanoseconds(sum.latch_wait_time);
+    stats.waits = {sum.waits, sum.timeouts,
+                   std::chrono::nanoseconds(sum.wait_time)};
+    stats.prefetches = {sum.prefetches_issued, sum.prefetches_used,
+                        sum.prefetches_wasted};
+    for (size_t i = 0; i < ThreadCounters::latency_buckets; ++i) {
+        stats.miss_latency[i] = sum.miss_latency[i];
     }
-    if (evict_frame->position == BufferFrame::FIFO) {
-        fifo.erase(std::find(fifo.begin(), fifo.end(), evict_frame->page_id));
-    } else {
-        lru.erase(std::find(lru.begin(), lru.end(), evict_frame->page_id));
+    for (size_t i = 0; i < partition_count; ++i) {
+        auto& partition = partitions[i];
+        // frames only become resident or stop being resident under the
+        // latch, and the frames that do not hold a page are unpinnable
+        std::lock_guard<std::mutex> partition_lock(partition.latch);
+        for (size_t j = 0; j < partition.max_page_count; ++j) {
+            auto& frame = partition.frames[j];
+            if (frame.thread_cnt.load() == BufferFrame::unpinnable) {
+                continue;
+            }
+            ++stats.resident_pages;
+            ++stats.segment_pages[get_segment_id(frame.page_id)];
+            if (frame.state == BufferFrame::DIRTY) {
+                ++stats.dirty_pages;
+            }
+        }
     }
-    bufferframes.erase(evict_id);
+    return stats;
 }
 
-void BufferManager::lock_frame(uint64_t page_id, bool exclusive) {
-    if (!exclusive) {
-        bufferframes[page_id].frame_latch.lock_shared();
-        bufferframes[page_id].thread_cnt++;
-    } else {
-        bufferframes[page_id].frame_latch.lock();
-        bufferframes[page_id].thread_cnt++;
+double BufferManager::Stats::hit_ratio() const {
+    if (hits + misses == 0) {
+        return 0.0;
     }
+    return static_cast<double>(hits) / static_cast<double>(hits + misses);
 }
 
-void BufferManager::unlock_frame(uint64_t page_id) {
-    bufferframes[page_id].frame_latch.unlock();
-    bufferframes[page_id].thread_cnt--;
+std::chrono::nanoseconds
+BufferManager::Stats::miss_latency_quantile(double quantile) const {
+    size_t count = 0;
+    for (auto misses : miss_latency) {
+        count += misses;
+    }
+    if (count == 0) {
+        return std::chrono::nanoseconds(0);
+    }
+    // the number of misses that are faster than the quantile
+    auto rank = std::min(
+        static_cast<size_t>(std::clamp(quantile, 0.0, 1.0) *
+                            static_cast<double>(count)),
+        count - 1);
+    size_t seen = 0;
+    size_t bucket = 0;
+    while ((seen += miss_latency[bucket]) <= rank) {
+        ++bucket;
+    }
+    return std::chrono::nanoseconds(uint64_t{1} << bucket);
 }
 
-void BufferManager::read_frame(uint64_t page_id,
-                               std::unique_lock<std::mutex>& manager_lock) {
-    // add a new frame into the hash table
-    // bufferframes.emplace(std::piecewise_construct,std::forward_as_tuple(page_id),std::forward_as_tuple(page_id,
-    // nullptr));
-    bufferframes[page_id].page_id = page_id;
-    auto& frame = bufferframes[page_id];
-    // std::lock_guard<std::shared_timed_mutex> frame_guard(frame.frame_latch);
-    const auto segment_id = get_segment_id(page_id);
-    const auto segment_page_id = get_segment_page_id(page_id);
+std::ostream& operator<<(std::ostream& out, const BufferManager::Stats& stats) {
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+    out << "hits=" << stats.hits << " misses=" << stats.misses
+        << " hit_ratio=" << std::fixed << std::setprecision(4)
+        << stats.hit_ratio() << std::defaultfloat
+        << " evictions=" << stats.evictions
+        << " dirty_writes=" << stats.dirty_writes
+        << " write_requests=" << stats.write_requests
+        << " latch_waits=" << stats.latch_waits << " latch_wait_us="
+        << duration_cast<microseconds>(stats.latch_wait_time).count()
+        << " frame_waits=" << stats.waits.waits
+        << " frame_wait_timeouts=" << stats.waits.timeouts
+        << " frame_wait_us="
+        << duration_cast<microseconds>(stats.waits.wait_time).count()
+        << " prefetches_issued=" << stats.prefetches.issued
+        << " prefetches_used=" << stats.prefetches.used
+        << " prefetches_wasted=" << stats.prefetches.wasted
+        << " miss_p50_ns=" << stats.miss_latency_quantile(0.5).count()
+        << " miss_p99_ns=" << stats.miss_latency_quantile(0.99).count()
+        << " resident=" << stats.resident_pages
+        << " dirty=" << stats.dirty_pages << " segments=";
+    const char* separator = "";
+    for (auto [segment_id, pages] : stats.segment_pages) {
+        out << separator << segment_id << ':' << pages;
+        separator = ",";
+    }
+    return out;
+}
+
+BufferManager::WaitStats BufferManager::get_wait_stats() const {
+    return stats().waits;
+}
+
+BufferManager::PrefetchStats BufferManager::get_prefetch_stats() const {
+    return stats().prefetches;
+}
+
+size_t BufferManager::get_hit_count() const {
+    ThreadCounters sum;
+    sum_counters(sum);
+    return sum.hits;
+}
+
+size_t BufferManager::get_miss_count() const {
+    ThreadCounters sum;
+    sum_counters(sum);
+    return sum.misses;
+}
+
+void BufferManager::lock_partition(
+    std::unique_lock<std::mutex>& partition_lock) {
+    if (partition_lock.try_lock()) {
+        return;
+    }
+    // only measure the time if the latch is actually contended
+    auto start = std::chrono::steady_clock::now();
+    partition_lock.lock();
+    add_latch_wait(start);
+}
+
+void BufferManager::add_latch_wait(std::chrono::steady_clock::time_point start) {
+    auto& thread_counters = counters();
+    ThreadCounters::add(thread_counters.latch_waits);
+    ThreadCounters::add(thread_counters.latch_wait_time, elapsed_ns(start));
+}
+
+void BufferManager::evict(Partition& partition, BufferFrame* evict_frame) {
+    try {
+        write_back_to_disk(partition, *evict_frame);
+    } catch (...) {
+        // the page stays resident and dirty, so release the claim to make it
+        // fixable and evictable again
+        evict_frame->thread_cnt.store(0, std::memory_order_release);
+        if (partition.waiters.load() > 0) {
+            partition.frame_unfixed.notify_all();
+        }
+        throw;
+    }
+    auto& thread_counters = counters();
+    if (evict_frame->prefetched.load(std::memory_order_relaxed)) {
+        evict_frame->prefetched.store(false, std::memory_order_relaxed);
+        ThreadCounters::add(thread_counters.prefetches_wasted);
+    }
+    ThreadCounters::add(thread_counters.evictions);
+    partition.policy->on_remove(*evict_frame);
+    partition.page_table.erase(evict_frame->page_id);
+    // optimistic readers of the page fail to validate from now on, the
+    // version stays odd until a new page was read into the frame. It is odd
+    // already if the page could not be read.
+    if (!(evict_frame->version.load(std::memory_order_relaxed) & 1)) {
+        evict_frame->version.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+}
+
+void BufferManager::resize(size_t new_page_count) {
+    std::lock_guard<std::mutex> resize_lock(resize_latch);
+    new_page_count = std::min(std::max(new_page_count, partition_count),
+                              max_page_count);
+    for (size_t i = 0; i < partition_count; ++i) {
+        resize_partition(partitions[i],
+                         new_page_count / partition_count +
+                             (i < new_page_count % partition_count));
+    }
+    page_count = new_page_count;
+}
 
-    // read from file and make it writable to write dirty data into the file
-    auto file_handle =
-        File::open_file(std::to_string(segment_id).c_str(), File::WRITE);
+size_t BufferManager::get_page_count() const { return page_count.load(); }
+
+void BufferManager::resize_partition(Partition& partition, size_t new_count) {
+    std::unique_lock<std::mutex> partition_lock(partition.latch,
+                                                std::defer_lock);
+    lock_partition(partition_lock);
+    const auto old_count = partition.page_count;
+    partition.page_count = new_count;
+    partition.policy->set_page_count(new_count);
+    if (new_count >= old_count) {
+        // the retired frames are unpinnable and hold no page, just like
+        // frames that were never used
+        for (size_t j = new_count; j-- > old_count;) {
+            partition.free_frames[frame_node(j)].push_back(&partition.frames[j]);
+        }
+        return;
+    }
+    auto* retired = partition.frames.get() + new_count;
+    for (auto& free_frames : partition.free_frames) {
+        std::erase_if(free_frames,
+                      [retired](BufferFrame* frame) { return frame >= retired; });
+    }
+    // evict the pages of the retired frames, waiting like fix_page_wait()
+    // for those that are fixed
+    partition.waiters.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    while (true) {
+        bool fixed = false;
+        for (size_t j = new_count; j < old_count; ++j) {
+            auto& frame = partition.frames[j];
+            if (frame.thread_cnt.load() == BufferFrame::unpinnable) {
+                continue;
+            }
+            if (!frame.try_claim()) {
+                fixed = true;
+                continue;
+            }
+            // the frame stays unpinnable
+            evict(partition, &frame);
+        }
+        if (!fixed) {
+            break;
+        }
+        partition.frame_unfixed.wait(partition_lock);
+    }
+    partition.waiters.fetch_sub(1);
+    partition_lock.unlock();
+    // nobody accesses the retired frames until they are handed out again
+    release_memory(&partition.buffer[new_count * page_size],
+                   &partition.buffer[old_count * page_size],
+                   get_pool_page_size());
+}
+
+void BufferManager::run_page_cleaner() {
+    if (cleaner_node >= 0 &&
+        static_cast<size_t>(cleaner_node) < NumaTopology::get().node_count()) {
+        NumaTopology::get().pin_thread(static_cast<unsigned>(cleaner_node));
+    }
+    std::unique_lock<std::mutex> cleaner_lock(cleaner_latch);
+    while (!stop_threads) {
+        cleaner_lock.unlock();
+        for (size_t i = 0; i < partition_count; ++i) {
+            clean_partition(partitions[i]);
+        }
+        cleaner_lock.lock();
+        cleaner_cv.wait_for(cleaner_lock, cleaner_interval);
+    }
+}
+
+void BufferManager::run_stats_dumper() {
+    std::unique_lock<std::mutex> cleaner_lock(cleaner_latch);
+    while (!stats_cv.wait_for(cleaner_lock, stats_interval,
+                              [this] { return stop_threads; })) {
+        cleaner_lock.unlock();
+        *stats_stream << stats() << '\n';
+        cleaner_lock.lock();
+    }
+}
+
+size_t BufferManager::clean_partition(Partition& partition) {
+    // collect the dirty frames among the next victims in eviction order and
+    // fix them, so that they stay resident after the partition is unlocked
+    std::vector<BufferFrame*> dirty_frames;
+    {
+        std::lock_guard<std::mutex> partition_lock(partition.latch);
+        auto window = static_cast<size_t>(
+            target_clean_ratio * static_cast<double>(partition.page_count) +
+            0.5);
+        partition.policy->collect_victims(window, dirty_frames);
+        // fixed frames are not evicted anyway and clean ones need no write
+        std::erase_if(dirty_frames, [](BufferFrame* frame) {
+            return frame->state != BufferFrame::DIRTY;
+        });
+        std::erase_if(dirty_frames,
+                      [](BufferFrame* frame) { return !frame->try_pin(); });
+    }
+    try {
+        write_fixed_frames(dirty_frames);
+    } catch (...) {
+        // leave the pages to the foreground eviction
+    }
+    return dirty_frames.size();
+}
+
+void BufferManager::write_fixed_frames(std::vector<BufferFrame*> frames) {
+    // in (segment, page) order, adjacent pages are written together
+    std::sort(frames.begin(), frames.end(),
+              [](const BufferFrame* lhs, const BufferFrame* rhs) {
+                  return lhs->page_id < rhs->page_id;
+              });
+    std::exception_ptr error;
+    std::vector<BufferFrame*> run;
+    auto release = [this](BufferFrame* frame) {
+        frame->frame_latch.unlock_shared();
+        unpin(get_partition(frame->page_id), *frame);
+    };
+    // writers need an exclusive latch, so the page does not change while the
+    // shared latch is held and can be marked clean before it is written
+    for (size_t i = 0; i < frames.size();) {
+        auto* first = frames[i++];
+        // a checkpoint may still be writing an older copy of the page
+        first->writing.wait(true);
+        first->frame_latch.lock_shared();
+        while (first->writing.load()) {
+            first->frame_latch.unlock_shared();
+            first->writing.wait(true);
+            first->frame_latch.lock_shared();
+        }
+        if (first->state != BufferFrame::DIRTY) {
+            release(first);
+            continue;
+        }
+        // only the first frame of a run waits for its latch, so a run never
+        // waits while it holds latches
+        run.assign(1, first);
+        while (i < frames.size() && run.size() < max_write_pages &&
+               frames[i]->page_id == run.back()->page_id + 1 &&
+               get_segment_id(frames[i]->page_id) ==
+                   get_segment_id(first->page_id) &&
+               frames[i]->frame_latch.try_lock_shared()) {
+            if (frames[i]->writing.load()) {
+                // left to the next run, which waits for the checkpoint
+                frames[i]->frame_latch.unlock_shared();
+                break;
+            }
+            auto* frame = frames[i++];
+            if (frame->state != BufferFrame::DIRTY) {
+                release(frame);
+                break;
+            }
+            run.push_back(frame);
+        }
+        for (auto* frame : run) {
+            frame->state = BufferFrame::CLEAN;
+        }
+        try {
+            write_frames(run);
+        } catch (...) {
+            for (auto* frame : run) {
+                frame->state = BufferFrame::DIRTY;
+            }
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+        for (auto* frame : run) {
+            release(frame);
+        }
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void BufferManager::flush_all() {
+    std::vector<BufferFrame*> dirty_frames;
+    for (size_t i = 0; i < partition_count; ++i) {
+        auto& partition = partitions[i];
+        std::lock_guard<std::mutex> partition_lock(partition.latch);
+        // only frames holding a page can be dirty, frames beyond the page
+        // count may still hold one during a resize()
+        for (size_t j = 0; j < partition.max_page_count; ++j) {
+            auto& frame = partition.frames[j];
+            // a claimed frame is written by the eviction that claimed it
+            if (frame.state == BufferFrame::DIRTY && frame.try_pin()) {
+                dirty_frames.push_back(&frame);
+            }
+        }
+    }
+    write_fixed_frames(dirty_frames);
+    segment_files.sync();
+}
+
+size_t BufferManager::checkpoint() {
+    struct DirtyPage {
+        uint64_t page_id;
+        BufferFrame* frame;
+        // the version and page LSN of the frame when the page was copied
+        uint64_t version;
+        uint64_t page_lsn;
+    };
+    // every record before is either in a page that is dirty or latched
+    // exclusively below, or in a page that was written already
+    const auto begin_lsn = log ? log->get_current_lsn() : 0;
+    std::vector<DirtyPage> dirty_pages;
+    for (size_t i = 0; i < partition_count; ++i) {
+        auto& partition = partitions[i];
+        std::lock_guard<std::mutex> partition_lock(partition.latch);
+        for (size_t j = 0; j < partition.max_page_count; ++j) {
+            auto& frame = partition.frames[j];
+            // a page that is latched exclusively may have been modified
+            // without being marked dirty yet
+            if ((frame.state == BufferFrame::DIRTY ||
+                 frame.version.load(std::memory_order_relaxed) & 1) &&
+                frame.thread_cnt.load() != BufferFrame::unpinnable) {
+                dirty_pages.push_back(
+                    {frame.page_id.load(std::memory_order_relaxed), &frame,
+                     0, 0});
+            }
+        }
+    }
+    std::sort(dirty_pages.begin(), dirty_pages.end(),
+              [](const DirtyPage& lhs, const DirtyPage& rhs) {
+                  return lhs.page_id < rhs.page_id;
+              });
+
+    // copies of adjacent pages that are written together
+    auto copies = allocate_pool(max_write_pages * page_size, false);
+    std::vector<DirtyPage> run;
+    std::vector<const char*> blocks;
+    size_t written = 0;
+    auto write_run = [&] {
+        if (run.empty()) {
+            return;
+        }
+        uint64_t page_lsn = 0;
+        for (auto& page : run) {
+            page_lsn = std::max(page_lsn, page.page_lsn);
+        }
+        std::exception_ptr error;
+        try {
+            write_pages(run.front().page_id, blocks, page_lsn);
+            written += run.size();
+        } catch (...) {
+            error = std::current_exception();
+        }
+        // the frames were kept fixed since they were copied. A page is only
+        // clean if it was not modified since.
+        for (auto& page : run) {
+            auto& frame = *page.frame;
+            if (!error) {
+                frame.frame_latch.lock_shared();
+                if (frame.state == BufferFrame::DIRTY &&
+                    frame.version.load(std::memory_order_relaxed) ==
+                        page.version) {
+                    frame.state = BufferFrame::CLEAN;
+                }
+                frame.frame_latch.unlock_shared();
+            }
+            frame.writing.store(false);
+            frame.writing.notify_all();
+            unpin(get_partition(page.page_id), frame);
+        }
+        run.clear();
+        blocks.clear();
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    };
+    for (auto& page : dirty_pages) {
+        if (!run.empty() &&
+            (run.size() == max_write_pages ||
+             page.page_id != run.back().page_id + 1 ||
+             get_segment_id(page.page_id) !=
+                 get_segment_id(run.front().page_id))) {
+            write_run();
+        }
+        // the frame may have been reassigned since it was collected
+        auto& frame = *page.frame;
+        if (!frame.try_pin()) {
+            continue;
+        }
+        if (frame.page_id != page.page_id) {
+            unpin(get_partition(page.page_id), frame);
+            continue;
+        }
+        // writers need an exclusive latch, so the copy is consistent
+        frame.frame_latch.lock_shared();
+        while (frame.writing.exchange(true)) {
+            // the older copy of a concurrent checkpoint must be written
+            // first. The own run is written before, so that two checkpoints
+            // never wait for each other.
+            frame.frame_latch.unlock_shared();
+            try {
+                write_run();
+            } catch (...) {
+                unpin(get_partition(page.page_id), frame);
+                throw;
+            }
+            frame.writing.wait(true);
+            frame.frame_latch.lock_shared();
+        }
+        if (frame.state != BufferFrame::DIRTY) {
+            frame.frame_latch.unlock_shared();
+            frame.writing.store(false);
+            frame.writing.notify_all();
+            unpin(get_partition(page.page_id), frame);
+            continue;
+        }
+        auto* copy = &copies[run.size() * page_size];
+        std::memcpy(copy, frame.data, page_size);
+        page.version = frame.version.load(std::memory_order_relaxed);
+        page.page_lsn = frame.page_lsn.load(std::memory_order_relaxed);
+        frame.frame_latch.unlock_shared();
+        run.push_back(page);
+        blocks.push_back(copy);
+    }
+    write_run();
+    segment_files.sync();
+    if (log) {
+        log->set_redo_lsn(begin_lsn);
+    }
+    return written;
+}
+
+void BufferManager::lock_frame(BufferFrame& frame, AccessMode mode) {
+    // a prefetched page may still be in flight. The version is odd until the
+    // read finished, so writers must not latch the frame before.
+    wait_for_read(frame);
+    switch (mode) {
+        case AccessMode::Shared:
+            if (!frame.frame_latch.try_lock_shared()) {
+                auto start = std::chrono::steady_clock::now();
+                frame.frame_latch.lock_shared();
+                add_latch_wait(start);
+            }
+            break;
+        case AccessMode::Exclusive:
+            if (!frame.frame_latch.try_lock()) {
+                auto start = std::chrono::steady_clock::now();
+                frame.frame_latch.lock();
+                add_latch_wait(start);
+            }
+            // make the version odd before the page is modified
+            frame.version.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            break;
+        case AccessMode::Optimistic:
+            break;
+    }
+}
+
+void BufferManager::read_frame(BufferFrame& frame) {
+    const auto segment_id = get_segment_id(frame.page_id);
+    const auto segment_page_id = get_segment_page_id(frame.page_id);
+
+    auto file_handle = segment_files.get(segment_id);
 
     // calculate the start position we want to read from the current segment
     auto start = segment_page_id * page_size;
 
-    // reserve space for the frame's data
-    // frame.data = new char[page_size];
-    // std::cout << "free_pos:  " << free_pos << std::endl;
-    frame.data = &buffer[free_pos];
-    frame.start_pos = free_pos;
     std::memset(frame.data, 0, page_size);
     file_handle->read_block(start, page_size, frame.data);
-    free_pos = (free_pos + page_size) % (page_count * page_size);
 }
 
-void BufferManager::write_back_to_disk(
-    BufferFrame* evict_frame, std::unique_lock<std::mutex>& manager_lock) {
-    if (evict_frame->state == BufferFrame::DIRTY) {
-        const auto segment_id = get_segment_id(evict_frame->page_id);
-        const auto segment_page_id = get_segment_page_id(evict_frame->page_id);
+std::vector<std::exception_ptr>
+BufferManager::read_frames(std::span<BufferFrame* const> frames) {
+    // shared with the completion callbacks, which may run after the last one
+    // woke up this thread
+    struct Batch {
+        std::atomic<size_t> pending;
+        std::vector<int> errors;
+    };
+    auto batch = std::make_shared<Batch>();
+    batch->pending = frames.size();
+    batch->errors.resize(frames.size());
+    std::vector<std::exception_ptr> errors(frames.size());
+    for (size_t i = 0; i < frames.size(); ++i) {
+        auto* frame = frames[i];
+        std::shared_ptr<File> file;
+        try {
+            file = segment_files.get(get_segment_id(frame->page_id));
+        } catch (...) {
+            // the other reads are in flight already and have to be waited for
+            errors[i] = std::current_exception();
+            batch->pending.fetch_sub(1);
+            continue;
+        }
+        std::memset(frame->data, 0, page_size);
+        file->read_block_async(
+            get_segment_page_id(frame->page_id) * page_size, page_size,
+            frame->data, [batch, file, i](int error) {
+                batch->errors[i] = error;
+                if (batch->pending.fetch_sub(1) == 1) {
+                    batch->pending.notify_all();
+                }
+            });
+    }
+    for (auto pending = batch->pending.load(); pending > 0;
+         pending = batch->pending.load()) {
+        batch->pending.wait(pending);
+    }
+    // retry failed reads synchronously
+    for (size_t i = 0; i < frames.size(); ++i) {
+        if (batch->errors[i] && !errors[i]) {
+            try {
+                read_frame(*frames[i]);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        }
+    }
+    return errors;
+}
+
+void BufferManager::write_back_to_disk(Partition& partition,
+                                       BufferFrame& evict_frame) {
+    if (evict_frame.state != BufferFrame::DIRTY) {
+        return;
+    }
+    const auto segment_id = get_segment_id(evict_frame.page_id);
+    // pins and latches the frame of a page if it is a dirty neighbour that
+    // can be written along without waiting
+    auto take_neighbour = [&](uint64_t page_id) -> BufferFrame* {
+        if (get_segment_id(page_id) != segment_id ||
+            &get_partition(page_id) != &partition) {
+            return nullptr;
+        }
+        auto index = partition.page_table.find(page_id);
+        if (index == PageTable::not_found) {
+            return nullptr;
+        }
+        auto& frame = partition.frames[index];
+        if (frame.state != BufferFrame::DIRTY || !frame.try_pin()) {
+            return nullptr;
+        }
+        if (!frame.frame_latch.try_lock_shared()) {
+            unpin_locked(partition, frame);
+            return nullptr;
+        }
+        // a checkpoint still writes an older copy of the page
+        if (frame.state != BufferFrame::DIRTY || frame.writing.load()) {
+            frame.frame_latch.unlock_shared();
+            unpin_locked(partition, frame);
+            return nullptr;
+        }
+        return &frame;
+    };
+    // the victim is claimed, so nobody else accesses it
+    std::vector<BufferFrame*> run{&evict_frame};
+    for (auto page_id = evict_frame.page_id - 1; run.size() < max_write_pages;
+         --page_id) {
+        auto* frame = take_neighbour(page_id);
+        if (!frame) {
+            break;
+        }
+        run.push_back(frame);
+    }
+    std::reverse(run.begin(), run.end());
+    for (auto page_id = evict_frame.page_id + 1; run.size() < max_write_pages;
+         ++page_id) {
+        auto* frame = take_neighbour(page_id);
+        if (!frame) {
+            break;
+        }
+        run.push_back(frame);
+    }
+    for (auto* frame : run) {
+        frame->state = BufferFrame::CLEAN;
+    }
+    std::exception_ptr error;
+    try {
+        write_frames(run);
+    } catch (...) {
+        for (auto* frame : run) {
+            frame->state = BufferFrame::DIRTY;
+        }
+        error = std::current_exception();
+    }
+    for (auto* frame : run) {
+        if (frame != &evict_frame) {
+            frame->frame_latch.unlock_shared();
+            unpin_locked(partition, *frame);
+        }
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
 
-        auto file_handle =
-            File::open_file(std::to_string(segment_id).c_str(), File::WRITE);
+void BufferManager::write_frames(std::span<BufferFrame* const> frames) {
+    std::vector<const char*> blocks;
+    blocks.reserve(frames.size());
+    uint64_t page_lsn = 0;
+    for (const auto* frame : frames) {
+        blocks.push_back(frame->data);
+        page_lsn = std::max(page_lsn,
+                            frame->page_lsn.load(std::memory_order_relaxed));
+    }
+    write_pages(frames.front()->page_id, blocks, page_lsn);
+}
+
+void BufferManager::write_pages(uint64_t page_id,
+                                std::span<const char* const> blocks,
+                                uint64_t page_lsn) {
+    if (log) {
+        // write-ahead rule
+        log->flush(page_lsn);
+    }
+    const auto segment_id = get_segment_id(page_id);
+    const auto segment_page_id = get_segment_page_id(page_id);
 
-        file_handle->write_block(evict_frame->data, segment_page_id * page_size,
-                                 page_size);
-        free_pos = evict_frame->start_pos;
+    auto file_handle = segment_files.get(segment_id);
+    file_handle->write_blocks(blocks, segment_page_id * page_size, page_size);
+    if (io_mode != File::SYNC) {
+        segment_files.mark_written(segment_id);
     }
-    // delete[] evict_frame->data;
+    auto& thread_counters = counters();
+    ThreadCounters::add(thread_counters.dirty_writes, blocks.size());
+    ThreadCounters::add(thread_counters.write_requests);
 }
 } // namespace moderndbs
@@ -0,0 +1,246 @@
+#include "moderndbs/io_uring.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <utility>
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#define MODERNDBS_HAVE_IO_URING 1
+#endif
+
+
+namespace moderndbs {
+
+#ifdef MODERNDBS_HAVE_IO_URING
+
+namespace {
+
+int io_uring_setup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+unsigned load_acquire(unsigned* value) {
+    return std::atomic_ref<unsigned>(*value).load(std::memory_order_acquire);
+}
+
+void store_release(unsigned* value, unsigned new_value) {
+    std::atomic_ref<unsigned>(*value).store(new_value, std::memory_order_release);
+}
+
+template <typename T>
+T* offset_ptr(void* base, uint32_t offset) {
+    return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+}
+
+}  // namespace
+
+struct IoUring::Request {
+    int fd;
+    size_t offset;
+    size_t remaining;
+    char* block;
+    ::iovec iov;
+    Callback on_complete;
+};
+
+IoUring::IoUring(unsigned entries) : entries(entries) {
+    io_uring_params params = {};
+    ring_fd = io_uring_setup(entries, &params);
+    if (ring_fd < 0) {
+        return;
+    }
+    this->entries = params.sq_entries;
+
+    sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        sq_ring_size = std::max(sq_ring_size, cq_ring_size);
+    }
+    sq_ring = ::mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    if (sq_ring == MAP_FAILED) {
+        sq_ring = nullptr;
+        return;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        cq_ring = sq_ring;
+    } else {
+        cq_ring = ::mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+        if (cq_ring == MAP_FAILED) {
+            cq_ring = nullptr;
+            return;
+        }
+    }
+    sqes = ::mmap(nullptr, params.sq_entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        sqes = nullptr;
+        return;
+    }
+
+    sq_head = offset_ptr<unsigned>(sq_ring, params.sq_off.head);
+    sq_tail = offset_ptr<unsigned>(sq_ring, params.sq_off.tail);
+    sq_mask = offset_ptr<unsigned>(sq_ring, params.sq_off.ring_mask);
+    sq_array = offset_ptr<unsigned>(sq_ring, params.sq_off.array);
+    cq_head = offset_ptr<unsigned>(cq_ring, params.cq_off.head);
+    cq_tail = offset_ptr<unsigned>(cq_ring, params.cq_off.tail);
+    cq_mask = offset_ptr<unsigned>(cq_ring, params.cq_off.ring_mask);
+    cqes = offset_ptr<void>(cq_ring, params.cq_off.cqes);
+
+    reaper = std::thread([this] { reap(); });
+}
+
+IoUring::~IoUring() {
+    if (reaper.joinable()) {
+        // wake up the completion thread with a no-op that has no request
+        std::unique_lock<std::mutex> submit_lock(submit_latch);
+        stopping = true;
+        ++in_flight;
+        if (push(nullptr) != 0) {
+            --in_flight;
+        }
+        submit_lock.unlock();
+        reaper.join();
+    }
+    if (sqes) {
+        ::munmap(sqes, entries * sizeof(io_uring_sqe));
+    }
+    if (cq_ring && cq_ring != sq_ring) {
+        ::munmap(cq_ring, cq_ring_size);
+    }
+    if (sq_ring) {
+        ::munmap(sq_ring, sq_ring_size);
+    }
+    if (ring_fd >= 0) {
+        ::close(ring_fd);
+    }
+}
+
+IoUring* IoUring::get() {
+    static auto ring = [] {
+        std::unique_ptr<IoUring> ring{new IoUring(256)};
+        if (!ring->reaper.joinable()) {
+            ring.reset();
+        }
+        return ring;
+    }();
+    return ring.get();
+}
+
+void IoUring::submit_read(int fd, size_t offset, size_t size, char* block, Callback on_complete) {
+    auto* request = new Request{fd, offset, size, block, {}, std::move(on_complete)};
+    std::unique_lock<std::mutex> submit_lock(submit_latch);
+    // bounding the reads in flight guarantees that neither the submission
+    // nor the completion queue can overflow
+    submit_cv.wait(submit_lock, [&] { return in_flight < entries; });
+    ++in_flight;
+    if (int error = push(request)) {
+        --in_flight;
+        submit_lock.unlock();
+        request->on_complete(error);
+        delete request;
+    }
+}
+
+int IoUring::push(Request* request) {
+    unsigned tail = *sq_tail;
+    unsigned index = tail & *sq_mask;
+    auto* sqe = static_cast<io_uring_sqe*>(sqes) + index;
+    std::memset(sqe, 0, sizeof(*sqe));
+    if (request) {
+        request->iov.iov_base = request->block;
+        request->iov.iov_len = request->remaining;
+        sqe->opcode = IORING_OP_READV;
+        sqe->fd = request->fd;
+        sqe->off = request->offset;
+        sqe->addr = reinterpret_cast<uint64_t>(&request->iov);
+        sqe->len = 1;
+    } else {
+        sqe->opcode = IORING_OP_NOP;
+    }
+    sqe->user_data = reinterpret_cast<uint64_t>(request);
+    sq_array[index] = index;
+    store_release(sq_tail, tail + 1);
+    while (io_uring_enter(ring_fd, 1, 0, 0) < 0) {
+        if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            // the kernel did not consume the entry, take it back so that it
+            // is not submitted along with a later one
+            int error = errno;
+            store_release(sq_tail, tail);
+            return error;
+        }
+        std::this_thread::yield();
+    }
+    return 0;
+}
+
+void IoUring::reap() {
+    while (true) {
+        if (io_uring_enter(ring_fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+            std::this_thread::yield();
+        }
+        unsigned head = *cq_head;
+        unsigned tail = load_acquire(cq_tail);
+        size_t finished = 0;
+        for (; head != tail; ++head) {
+            const auto& cqe = static_cast<io_uring_cqe*>(cqes)[head & *cq_mask];
+            auto* request = reinterpret_cast<Request*>(cqe.user_data);
+            int result = cqe.res;
+            if (!request) {
+                ++finished;
+                continue;
+            }
+            if (result > 0 && static_cast<size_t>(result) < request->remaining) {
+                // short read, continue with the rest of the block
+                request->offset += result;
+                request->block += result;
+                request->remaining -= result;
+                int error = 0;
+                {
+                    std::lock_guard<std::mutex> submit_lock(submit_latch);
+                    error = push(request);
+                }
+                if (error == 0) {
+                    continue;
+                }
+                result = -error;
+            }
+            // 0 means end of file, which is not an error
+            request->on_complete(result < 0 ? -result : 0);
+            delete request;
+            ++finished;
+        }
+        store_release(cq_head, head);
+
+        std::lock_guard<std::mutex> submit_lock(submit_latch);
+        in_flight -= finished;
+        submit_cv.notify_all();
+        if (stopping && in_flight == 0) {
+            return;
+        }
+    }
+}
+
+#else
+
+IoUring::~IoUring() = default;
+
+IoUring* IoUring::get() {
+    return nullptr;
+}
+
+void IoUring::submit_read(int, size_t, size_t, char*, Callback on_complete) {
+    on_complete(ENOSYS);
+}
+
+#endif
+
+}  // namespace moderndbs
@@ -1,12 +1,18 @@
 #include "moderndbs/file.h"
+#include "moderndbs/io_uring.h"
 #include <fcntl.h>
 #include <stdlib.h>  // NOLINT
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <unistd.h>
+#include <algorithm>
 #include <cerrno>
+#include <climits>
 #include <memory>
 #include <system_error>
+#include <utility>
+#include <vector>
 
 
 namespace moderndbs {
@@ -31,13 +37,23 @@ namespace {
 
 PosixFile::PosixFile(Mode mode, int fd, size_t size) : mode(mode), fd(fd), cached_size(size) {}
 
-PosixFile::PosixFile(const char* filename, Mode mode) : mode(mode) {
+PosixFile::PosixFile(const char* filename, Mode mode, IOMode io_mode) : mode(mode) {
+        int flags = O_CLOEXEC;
+        switch (io_mode) {
+            case SYNC: flags |= O_SYNC; break;
+            case BUFFERED: break;
+            case DIRECT: flags |= O_DIRECT; break;
+        }
         switch (mode) {
             case READ:
-                fd = ::open(filename, O_RDONLY | O_SYNC | O_CLOEXEC);
+                fd = ::open(filename, O_RDONLY | flags);
                 break;
             case WRITE:
-                fd = ::open(filename, O_RDWR | O_CREAT | O_SYNC | O_CLOEXEC, 0666);
+                fd = ::open(filename, O_RDWR | O_CREAT | flags, 0666);
+        }
+        if (fd < 0 && errno == EINVAL && io_mode == DIRECT) {
+            // the file system does not support O_DIRECT
+            fd = ::open(filename, mode == READ ? O_RDONLY | O_CLOEXEC : O_RDWR | O_CREAT | O_CLOEXEC, 0666);
         }
         if (fd < 0) {
             throw_errno();
@@ -91,6 +107,14 @@ void PosixFile::read_block(size_t offset, size_t size, char* block) {
     }
 }
 
+void PosixFile::read_block_async(size_t offset, size_t size, char* block, ReadCallback on_complete) {
+    if (auto* ring = IoUring::get()) {
+        ring->submit_read(fd, offset, size, block, std::move(on_complete));
+    } else {
+        File::read_block_async(offset, size, block, std::move(on_complete));
+    }
+}
+
 void PosixFile::write_block(const char* block, size_t offset, size_t size) {
     size_t total_bytes_written = 0;
     while (total_bytes_written < size) {
@@ -112,9 +136,67 @@ void PosixFile::write_block(const char* block, size_t offset, size_t size) {
     }
 }
 
+void PosixFile::write_blocks(std::span<const char* const> blocks, size_t offset, size_t block_size) {
+    std::vector<::iovec> vectors(blocks.size());
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        vectors[i] = {const_cast<char*>(blocks[i]), block_size}; // NOLINT(cppcoreguidelines-pro-type-const-cast)
+    }
+    auto* next = vectors.data();
+    auto* end = next + vectors.size();
+    while (next != end) {
+        ssize_t bytes_written = ::pwritev(
+            fd,
+            next,
+            static_cast<int>(std::min<ptrdiff_t>(end - next, IOV_MAX)),
+            static_cast<off_t>(offset)
+        );
+        if (bytes_written == 0) {
+            // See `write_block()`.
+            return;
+        }
+        if (bytes_written < 0) {
+            throw_errno();
+        }
+        offset += static_cast<size_t>(bytes_written);
+        // skip the blocks that were written completely and continue within
+        // the block that was written partially
+        auto remaining = static_cast<size_t>(bytes_written);
+        while (next != end && remaining >= next->iov_len) {
+            remaining -= next->iov_len;
+            ++next;
+        }
+        if (remaining > 0) {
+            next->iov_base = static_cast<char*>(next->iov_base) + remaining;
+            next->iov_len -= remaining;
+        }
+    }
+}
+
+void PosixFile::sync() {
+    if (::fdatasync(fd) < 0) {
+        throw_errno();
+    }
+}
+
+void File::read_block_async(size_t offset, size_t size, char* block, ReadCallback on_complete) {
+    int error = 0;
+    try {
+        read_block(offset, size, block);
+    } catch (const std::system_error& e) {
+        error = e.code().value();
+    }
+    on_complete(error);
+}
+
+void File::write_blocks(std::span<const char* const> blocks, size_t offset, size_t block_size) {
+    for (const auto* block : blocks) {
+        write_block(block, offset, block_size);
+        offset += block_size;
+    }
+}
 
-std::unique_ptr<File> File::open_file(const char* filename, Mode mode) {
-    return std::make_unique<PosixFile>(filename, mode);
+std::unique_ptr<File> File::open_file(const char* filename, Mode mode, IOMode io_mode) {
+    return std::make_unique<PosixFile>(filename, mode, io_mode);
 }
 
 
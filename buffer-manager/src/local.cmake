@@ -15,9 +15,14 @@ set(
 # Files
 # ---------------------------------------------------------------------------
 
-set(SRC_CC src/buffer_manager.cc)
+set(
+    SRC_CC src/buffer_manager.cc src/log_manager.cc
+    src/mmap_buffer_manager.cc src/numa.cc src/page_guard.cc
+    src/page_table.cc src/replacement_policy.cc src/scan_cursor.cc
+    src/segment_file_cache.cc
+)
 if(UNIX)
-    set(SRC_CC ${SRC_CC} src/file/posix_file.cc)
+    set(SRC_CC ${SRC_CC} src/file/posix_file.cc src/file/io_uring.cc)
 elseif(WIN32)
     message(SEND_ERROR "Windows is not supported")
 else()
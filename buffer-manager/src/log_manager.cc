@@ -0,0 +1,235 @@
+#include "moderndbs/log_manager.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace moderndbs {
+
+namespace {
+
+/// The log file is grown in steps of this size.
+constexpr uint64_t preallocation = 4 << 20;
+
+/// Identifies log files, stored in front of the redo LSN.
+constexpr uint64_t log_magic = 0x474f4c53424d444dull;
+
+/// Layout of a record, followed by `length` bytes of data. The checksum
+/// covers the rest of the header, the data and the LSN the record starts
+/// at, so that stale or torn records are detected.
+struct RecordHeader {
+    uint32_t checksum;
+    uint32_t length;
+    uint64_t page_id;
+    uint32_t offset;
+    uint32_t unused;
+};
+static_assert(sizeof(RecordHeader) == LogManager::header_size);
+
+/// FNV-1a over `size` bytes, continuing from `hash`.
+uint32_t fnv1a(const char* data, size_t size, uint32_t hash = 2166136261u) {
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+uint32_t record_checksum(const RecordHeader& header, const char* data,
+                         uint64_t start_lsn) {
+    auto hash = fnv1a(reinterpret_cast<const char*>(&header) + sizeof(uint32_t),
+                      sizeof(RecordHeader) - sizeof(uint32_t));
+    hash = fnv1a(data, header.length, hash);
+    return fnv1a(reinterpret_cast<const char*>(&start_lsn), sizeof(start_lsn),
+                 hash);
+}
+
+/// Reads the header of the record at the start of `bytes`, which starts at
+/// `start_lsn`. Returns false if there is no complete, valid record.
+bool parse_record(std::span<const char> bytes, uint64_t start_lsn,
+                  RecordHeader& header) {
+    if (bytes.size() < sizeof(RecordHeader)) {
+        return false;
+    }
+    std::memcpy(&header, bytes.data(), sizeof(RecordHeader));
+    if (bytes.size() - sizeof(RecordHeader) < header.length) {
+        return false;
+    }
+    return header.checksum ==
+           record_checksum(header, bytes.data() + sizeof(RecordHeader),
+                           start_lsn);
+}
+
+} // namespace
+
+LogManager::LogManager(const char* filename, size_t buffer_size)
+    : file(File::open_file(filename, File::WRITE, File::BUFFERED)),
+      buffer(std::make_unique<char[]>(buffer_size)), capacity(buffer_size),
+      redo_lsn(first_lsn) {
+    uint64_t end = first_lsn;
+    if (file->size() < first_lsn) {
+        // a new log
+        file->resize(first_lsn);
+        write_header();
+    } else {
+        uint64_t header[2];
+        file->read_block(0, sizeof(header), reinterpret_cast<char*>(header));
+        if (header[0] != log_magic) {
+            throw std::runtime_error{"not a log file"};
+        }
+        redo_lsn = header[1];
+        // find the end of the log, the records since the redo LSN are read
+        // again by redo()
+        std::vector<char> tail(file->size() - std::min(redo_lsn, file->size()));
+        file->read_block(redo_lsn, tail.size(), tail.data());
+        end = redo_lsn;
+        RecordHeader record{};
+        while (parse_record(std::span<const char>(tail).subspan(end - redo_lsn),
+                            end, record)) {
+            end += sizeof(RecordHeader) + record.length;
+        }
+        // new records must not be followed by stale ones
+        file->resize(end);
+    }
+    reserved_lsn = end;
+    filled_lsn = end;
+    flushed_lsn = end;
+    allocated_lsn = std::max(end, first_lsn);
+}
+
+LogManager::~LogManager() {
+    try {
+        flush(get_current_lsn());
+    } catch (...) {
+        // a destructor must not throw, the records are lost like on a crash
+    }
+}
+
+void LogManager::copy_in(uint64_t lsn, const char* data, size_t size) {
+    auto position = lsn % capacity;
+    auto first = std::min(size, capacity - position);
+    std::memcpy(&buffer[position], data, first);
+    std::memcpy(&buffer[0], data + first, size - first);
+}
+
+uint64_t LogManager::append(uint64_t page_id, uint32_t offset,
+                            std::span<const char> data) {
+    const auto size = sizeof(RecordHeader) + data.size();
+    if (size > capacity) {
+        throw std::length_error{"log record does not fit into the log buffer"};
+    }
+    const auto start = reserved_lsn.fetch_add(size);
+    const auto end = start + size;
+    // wait until the part of the buffer the record goes to is flushed
+    while (end - flushed_lsn.load(std::memory_order_acquire) > capacity) {
+        if (std::unique_lock<std::mutex> flush_lock(flush_latch, std::try_to_lock);
+            flush_lock) {
+            write_filled();
+        }
+        std::this_thread::yield();
+    }
+    RecordHeader header{0, static_cast<uint32_t>(data.size()), page_id, offset, 0};
+    header.checksum = record_checksum(header, data.data(), start);
+    copy_in(start, reinterpret_cast<const char*>(&header), sizeof(header));
+    copy_in(start + sizeof(header), data.data(), data.size());
+    // the filled part must not have gaps, so records are published in log
+    // order
+    for (auto filled = filled_lsn.load(std::memory_order_acquire);
+         filled != start; filled = filled_lsn.load(std::memory_order_acquire)) {
+        filled_lsn.wait(filled, std::memory_order_acquire);
+    }
+    filled_lsn.store(end, std::memory_order_release);
+    filled_lsn.notify_all();
+    return end;
+}
+
+void LogManager::write_filled() {
+    const auto from = flushed_lsn.load(std::memory_order_relaxed);
+    const auto to = filled_lsn.load(std::memory_order_acquire);
+    if (to == from) {
+        return;
+    }
+    if (to > allocated_lsn) {
+        // write zeros ahead of the log once, so that syncs of the log only
+        // have to write the new records and no metadata
+        auto new_end = (to / preallocation + 1) * preallocation;
+        std::vector<char> zeros(new_end - allocated_lsn);
+        file->write_block(zeros.data(), allocated_lsn, zeros.size());
+        allocated_lsn = new_end;
+    }
+    auto position = from % capacity;
+    auto size = to - from;
+    auto first = std::min(size, capacity - position);
+    file->write_block(&buffer[position], from, first);
+    if (size > first) {
+        file->write_block(&buffer[0], from + first, size - first);
+    }
+    file->sync();
+    flush_count.fetch_add(1, std::memory_order_relaxed);
+    flushed_lsn.store(to, std::memory_order_release);
+    flushed_lsn.notify_all();
+}
+
+void LogManager::flush(uint64_t lsn) {
+    lsn = std::min(lsn, reserved_lsn.load());
+    if (flushed_lsn.load(std::memory_order_acquire) >= lsn) {
+        return;
+    }
+    // while one thread syncs, the others queue up here and usually find
+    // their records flushed along once they get the latch
+    std::lock_guard<std::mutex> flush_lock(flush_latch);
+    while (flushed_lsn.load(std::memory_order_relaxed) < lsn) {
+        auto filled = filled_lsn.load(std::memory_order_acquire);
+        if (filled == flushed_lsn.load(std::memory_order_relaxed)) {
+            // the next record is still being copied
+            filled_lsn.wait(filled, std::memory_order_acquire);
+            continue;
+        }
+        write_filled();
+    }
+}
+
+uint64_t LogManager::get_current_lsn() const { return reserved_lsn.load(); }
+
+uint64_t LogManager::get_flushed_lsn() const { return flushed_lsn.load(); }
+
+size_t LogManager::get_flush_count() const {
+    return flush_count.load(std::memory_order_relaxed);
+}
+
+void LogManager::write_header() {
+    uint64_t header[2] = {log_magic, redo_lsn};
+    file->write_block(reinterpret_cast<const char*>(header), 0, sizeof(header));
+    file->sync();
+}
+
+void LogManager::set_redo_lsn(uint64_t lsn) {
+    // the log must not end before the redo LSN
+    flush(lsn);
+    std::lock_guard<std::mutex> flush_lock(flush_latch);
+    redo_lsn = std::max(lsn, redo_lsn);
+    write_header();
+}
+
+size_t LogManager::redo(const RedoCallback& apply) {
+    const auto end = flushed_lsn.load();
+    std::vector<char> records(end - redo_lsn);
+    file->read_block(redo_lsn, records.size(), records.data());
+    size_t count = 0;
+    RecordHeader header{};
+    for (auto lsn = redo_lsn; lsn < end;) {
+        std::span<const char> bytes(records);
+        bytes = bytes.subspan(lsn - redo_lsn);
+        if (!parse_record(bytes, lsn, header)) {
+            break;
+        }
+        lsn += sizeof(RecordHeader) + header.length;
+        apply(header.page_id, header.offset,
+              bytes.subspan(sizeof(RecordHeader), header.length), lsn);
+        ++count;
+    }
+    return count;
+}
+
+} // namespace moderndbs
@@ -0,0 +1,154 @@
+#include "moderndbs/mmap_buffer_manager.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+namespace moderndbs {
+
+namespace {
+
+/// Segment files are grown in steps of at least this size, so that filling
+/// a segment page by page does not change the file size every time.
+constexpr size_t grow_step = 1 << 20;
+
+[[noreturn]] void throw_errno() {
+    throw std::system_error{errno, std::system_category()};
+}
+
+} // namespace
+
+MmapBufferManager::MmapBufferManager(size_t page_size, size_t /*page_count*/,
+                                     size_t reservation)
+    : page_size(page_size), reservation(reservation),
+      segments(std::make_unique<std::atomic<Segment*>[]>(size_t{1} << 16)) {}
+
+MmapBufferManager::~MmapBufferManager() {
+    for (auto& segment : open_segments) {
+        ::munmap(segment->data, reservation);
+        ::close(segment->fd);
+    }
+}
+
+MmapBufferManager::Segment& MmapBufferManager::get_segment(uint16_t segment_id) {
+    if (auto* segment = segments[segment_id].load(std::memory_order_acquire)) {
+        return *segment;
+    }
+    std::lock_guard<std::mutex> segments_lock(segments_latch);
+    if (auto* segment = segments[segment_id].load(std::memory_order_relaxed)) {
+        return *segment;
+    }
+    auto segment = std::make_unique<Segment>();
+    segment->fd = ::open(std::to_string(segment_id).c_str(),
+                         O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+    if (segment->fd < 0) {
+        throw_errno();
+    }
+    struct ::stat file_stat = {};
+    if (::fstat(segment->fd, &file_stat) < 0) {
+        auto error = errno;
+        ::close(segment->fd);
+        throw std::system_error{error, std::system_category()};
+    }
+    segment->size = file_stat.st_size;
+    // the whole reservation is mapped at once, so the mapping never moves
+    // when the file grows
+    void* data = ::mmap(nullptr, reservation, PROT_READ | PROT_WRITE,
+                        MAP_SHARED, segment->fd, 0);
+    if (data == MAP_FAILED) {
+        auto error = errno;
+        ::close(segment->fd);
+        throw std::system_error{error, std::system_category()};
+    }
+    segment->data = static_cast<char*>(data);
+    auto* result = segment.get();
+    open_segments.push_back(std::move(segment));
+    segments[segment_id].store(result, std::memory_order_release);
+    return *result;
+}
+
+char* MmapBufferManager::map_page(uint64_t page_id) {
+    auto& segment = get_segment(get_segment_id(page_id));
+    const auto offset = get_segment_page_id(page_id) * page_size;
+    if (offset + page_size > reservation) {
+        throw std::out_of_range{"page lies beyond the mapped segment"};
+    }
+    if (segment.size.load(std::memory_order_acquire) < offset + page_size) {
+        // touching the mapping beyond the end of the file raises SIGBUS
+        std::lock_guard<std::mutex> grow_lock(segment.grow_latch);
+        auto size = segment.size.load(std::memory_order_relaxed);
+        if (size < offset + page_size) {
+            auto new_size = std::min(
+                std::max(offset + page_size, size + grow_step), reservation);
+            if (::ftruncate(segment.fd, new_size) < 0) {
+                throw_errno();
+            }
+            segment.size.store(new_size, std::memory_order_release);
+        }
+    }
+    return segment.data + offset;
+}
+
+void MmapBufferManager::flush_all() {
+    std::lock_guard<std::mutex> segments_lock(segments_latch);
+    for (auto& segment : open_segments) {
+        // fsync also writes the pages that were modified through the mapping
+        if (::fsync(segment->fd) < 0) {
+            throw_errno();
+        }
+    }
+}
+
+MmapBufferFrame& MmapBufferManager::fix_page(uint64_t page_id, bool exclusive) {
+    auto* data = map_page(page_id);
+    auto& shard = shards[(page_id ^ (page_id >> 48)) % shard_count];
+    MmapBufferFrame* frame;
+    {
+        std::lock_guard<std::mutex> shard_lock(shard.latch);
+        auto& entry = shard.frames[page_id];
+        if (!entry) {
+            if (shard.spare_frames.empty()) {
+                entry = std::make_unique<MmapBufferFrame>();
+            } else {
+                entry = std::move(shard.spare_frames.back());
+                shard.spare_frames.pop_back();
+            }
+            entry->page_id = page_id;
+            entry->data = data;
+        }
+        frame = entry.get();
+        ++frame->thread_cnt;
+    }
+    // the frame stays in the side table while it is fixed, so the latch can
+    // be waited for without the shard latch
+    if (exclusive) {
+        frame->frame_latch.lock();
+        frame->exclusive = true;
+    } else {
+        frame->frame_latch.lock_shared();
+    }
+    return *frame;
+}
+
+void MmapBufferManager::unfix_page(MmapBufferFrame& page, bool /*is_dirty*/) {
+    if (page.exclusive) {
+        page.exclusive = false;
+        page.frame_latch.unlock();
+    } else {
+        page.frame_latch.unlock_shared();
+    }
+    auto& shard = shards[(page.page_id ^ (page.page_id >> 48)) % shard_count];
+    std::lock_guard<std::mutex> shard_lock(shard.latch);
+    if (--page.thread_cnt == 0) {
+        auto entry = shard.frames.find(page.page_id);
+        shard.spare_frames.push_back(std::move(entry->second));
+        shard.frames.erase(entry);
+    }
+}
+
+} // namespace moderndbs
@@ -0,0 +1,133 @@
+#include "moderndbs/numa.h"
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <string>
+#if __has_include(<linux/mempolicy.h>)
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define MODERNDBS_HAVE_NUMA 1
+#endif
+
+namespace moderndbs {
+
+namespace {
+
+/// Parses a sysfs list like "0-3,8,10-11".
+std::vector<unsigned> parse_list(const std::string& list) {
+    std::vector<unsigned> values;
+    std::stringstream ranges(list);
+    std::string range;
+    while (std::getline(ranges, range, ',')) {
+        unsigned first = 0;
+        unsigned last = 0;
+        char dash = 0;
+        std::stringstream bounds(range);
+        if (!(bounds >> first)) {
+            continue;
+        }
+        last = (bounds >> dash >> last) ? last : first;
+        for (auto value = first; value <= last; ++value) {
+            values.push_back(value);
+        }
+    }
+    return values;
+}
+
+/// Returns the first line of a sysfs file, empty if it cannot be read.
+std::string read_line(const std::string& path) {
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+
+} // namespace
+
+NumaTopology::NumaTopology() {
+#ifdef MODERNDBS_HAVE_NUMA
+    for (auto node_id : parse_list(read_line("/sys/devices/system/node/online"))) {
+        auto cpus = parse_list(read_line("/sys/devices/system/node/node" +
+                                         std::to_string(node_id) + "/cpulist"));
+        if (cpus.empty()) {
+            // memory-only nodes have no threads that could be local to them
+            continue;
+        }
+        for (auto cpu : cpus) {
+            if (cpu >= cpu_nodes.size()) {
+                cpu_nodes.resize(cpu + 1, 0);
+            }
+            cpu_nodes[cpu] = static_cast<unsigned>(node_ids.size());
+        }
+        node_ids.push_back(node_id);
+        node_cpus.push_back(std::move(cpus));
+    }
+#endif
+    if (node_ids.size() <= 1) {
+        node_ids.assign(1, 0);
+        node_cpus.assign(1, {});
+        cpu_nodes.clear();
+    }
+}
+
+const NumaTopology& NumaTopology::get() {
+    static const NumaTopology topology;
+    return topology;
+}
+
+unsigned NumaTopology::current_node() const {
+#ifdef MODERNDBS_HAVE_NUMA
+    if (node_count() > 1) {
+        int cpu = sched_getcpu();
+        if (cpu >= 0 && static_cast<size_t>(cpu) < cpu_nodes.size()) {
+            return cpu_nodes[cpu];
+        }
+    }
+#endif
+    return 0;
+}
+
+bool NumaTopology::place_memory(void* memory, size_t size, unsigned node) const {
+#ifdef MODERNDBS_HAVE_NUMA
+    if (node_count() <= 1 || size == 0) {
+        return true;
+    }
+    constexpr uintptr_t os_page_size = 4096;
+    auto begin = reinterpret_cast<uintptr_t>(memory) / os_page_size * os_page_size;
+    auto end = (reinterpret_cast<uintptr_t>(memory) + size + os_page_size - 1) /
+               os_page_size * os_page_size;
+    auto node_id = node_ids[node];
+    std::vector<unsigned long> mask(node_id / (8 * sizeof(unsigned long)) + 1);
+    mask[node_id / (8 * sizeof(unsigned long))] |=
+        1ul << (node_id % (8 * sizeof(unsigned long)));
+    // the kernel expects one more than the number of bits in the mask
+    return ::syscall(SYS_mbind, begin, end - begin, MPOL_PREFERRED, mask.data(),
+                     mask.size() * 8 * sizeof(unsigned long) + 1, 0) == 0;
+#else
+    (void)memory;
+    (void)size;
+    (void)node;
+    return node_count() <= 1;
+#endif
+}
+
+bool NumaTopology::pin_thread(unsigned node) const {
+#ifdef MODERNDBS_HAVE_NUMA
+    if (node_count() <= 1) {
+        return true;
+    }
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (auto cpu : node_cpus[node]) {
+        CPU_SET(cpu, &cpus);
+    }
+    return sched_setaffinity(0, sizeof(cpus), &cpus) == 0;
+#else
+    (void)node;
+    return true;
+#endif
+}
+
+} // namespace moderndbs
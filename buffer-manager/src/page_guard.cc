@@ -0,0 +1,109 @@
+#include "moderndbs/page_guard.h"
+#include <utility>
+
+namespace moderndbs {
+
+SharedPageGuard::SharedPageGuard(BufferManager& buffer_manager,
+                                 BufferFrame& frame)
+    : buffer_manager(&buffer_manager), frame(&frame) {}
+
+SharedPageGuard::SharedPageGuard(BufferManager& buffer_manager,
+                                 uint64_t page_id)
+    : buffer_manager(&buffer_manager),
+      frame(&buffer_manager.fix_page(page_id, AccessMode::Shared)) {}
+
+SharedPageGuard::SharedPageGuard(SharedPageGuard&& other) noexcept
+    : buffer_manager(other.buffer_manager),
+      frame(std::exchange(other.frame, nullptr)) {}
+
+SharedPageGuard& SharedPageGuard::operator=(SharedPageGuard&& other) noexcept {
+    if (this != &other) {
+        release();
+        buffer_manager = other.buffer_manager;
+        frame = std::exchange(other.frame, nullptr);
+    }
+    return *this;
+}
+
+SharedPageGuard::~SharedPageGuard() { release(); }
+
+void SharedPageGuard::release() {
+    if (frame) {
+        buffer_manager->unfix_page(*std::exchange(frame, nullptr), false);
+    }
+}
+
+ExclusivePageGuard SharedPageGuard::try_upgrade() {
+    if (!buffer_manager->upgrade_page(*frame)) {
+        return {};
+    }
+    return {*buffer_manager, *std::exchange(frame, nullptr)};
+}
+
+ExclusivePageGuard::ExclusivePageGuard(BufferManager& buffer_manager,
+                                       BufferFrame& frame)
+    : buffer_manager(&buffer_manager), frame(&frame) {}
+
+ExclusivePageGuard::ExclusivePageGuard(BufferManager& buffer_manager,
+                                       uint64_t page_id)
+    : buffer_manager(&buffer_manager),
+      frame(&buffer_manager.fix_page(page_id, AccessMode::Exclusive)) {}
+
+ExclusivePageGuard::ExclusivePageGuard(ExclusivePageGuard&& other) noexcept
+    : buffer_manager(other.buffer_manager),
+      frame(std::exchange(other.frame, nullptr)),
+      dirty(std::exchange(other.dirty, false)) {}
+
+ExclusivePageGuard&
+ExclusivePageGuard::operator=(ExclusivePageGuard&& other) noexcept {
+    if (this != &other) {
+        release();
+        buffer_manager = other.buffer_manager;
+        frame = std::exchange(other.frame, nullptr);
+        dirty = std::exchange(other.dirty, false);
+    }
+    return *this;
+}
+
+ExclusivePageGuard::~ExclusivePageGuard() { release(); }
+
+void ExclusivePageGuard::release() {
+    if (frame) {
+        buffer_manager->unfix_page(*std::exchange(frame, nullptr),
+                                   std::exchange(dirty, false));
+    }
+}
+
+SharedPageGuard ExclusivePageGuard::downgrade() {
+    buffer_manager->downgrade_page(*frame, std::exchange(dirty, false));
+    return {*buffer_manager, *std::exchange(frame, nullptr)};
+}
+
+OptimisticPageGuard::OptimisticPageGuard(BufferManager& buffer_manager,
+                                         uint64_t page_id)
+    : buffer_manager(&buffer_manager),
+      frame(&buffer_manager.fix_page(page_id, AccessMode::Optimistic)) {}
+
+OptimisticPageGuard::OptimisticPageGuard(OptimisticPageGuard&& other) noexcept
+    : buffer_manager(other.buffer_manager),
+      frame(std::exchange(other.frame, nullptr)) {}
+
+OptimisticPageGuard&
+OptimisticPageGuard::operator=(OptimisticPageGuard&& other) noexcept {
+    if (this != &other) {
+        release();
+        buffer_manager = other.buffer_manager;
+        frame = std::exchange(other.frame, nullptr);
+    }
+    return *this;
+}
+
+OptimisticPageGuard::~OptimisticPageGuard() { release(); }
+
+void OptimisticPageGuard::release() {
+    if (frame) {
+        buffer_manager->unfix_optimistic(*std::exchange(frame, nullptr));
+    }
+}
+
+} // namespace moderndbs
@@ -0,0 +1,76 @@
+#include "moderndbs/page_table.h"
+#include <bit>
+#include <cassert>
+
+namespace moderndbs {
+
+PageTable::PageTable(size_t capacity)
+    : mask(std::bit_ceil(2 * capacity + 1) - 1) {
+    entries = std::make_unique<Entry[]>(mask + 1);
+}
+
+size_t PageTable::home(uint64_t page_id) const {
+    // page ids of a segment are dense, so mix all bits before masking
+    page_id ^= page_id >> 33;
+    page_id *= 0xff51afd7ed558ccdull;
+    page_id ^= page_id >> 33;
+    return page_id & mask;
+}
+
+uint32_t PageTable::find(uint64_t page_id) const {
+    // entries may move concurrently, so a probe run is not guaranteed to end
+    // at an empty slot within the number of slots
+    auto slot = home(page_id);
+    for (size_t probes = 0; probes <= mask; ++probes) {
+        const auto& entry = entries[slot];
+        auto frame = entry.frame.load(std::memory_order_relaxed);
+        if (frame == 0) {
+            break;
+        }
+        if (entry.page_id.load(std::memory_order_relaxed) == page_id) {
+            return frame - 1;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return not_found;
+}
+
+void PageTable::insert(uint64_t page_id, uint32_t frame) {
+    auto slot = home(page_id);
+    while (entries[slot].frame.load(std::memory_order_relaxed) != 0) {
+        assert(entries[slot].page_id.load(std::memory_order_relaxed) != page_id);
+        slot = (slot + 1) & mask;
+    }
+    entries[slot].page_id.store(page_id, std::memory_order_relaxed);
+    entries[slot].frame.store(frame + 1, std::memory_order_relaxed);
+}
+
+void PageTable::erase(uint64_t page_id) {
+    auto slot = home(page_id);
+    while (entries[slot].page_id.load(std::memory_order_relaxed) != page_id ||
+           entries[slot].frame.load(std::memory_order_relaxed) == 0) {
+        assert(entries[slot].frame.load(std::memory_order_relaxed) != 0);
+        slot = (slot + 1) & mask;
+    }
+    // move every following entry of the probe run that would no longer be
+    // found into the hole
+    auto hole = slot;
+    for (slot = (slot + 1) & mask;
+         entries[slot].frame.load(std::memory_order_relaxed) != 0;
+         slot = (slot + 1) & mask) {
+        auto moved_id = entries[slot].page_id.load(std::memory_order_relaxed);
+        auto ideal = home(moved_id);
+        // the entry may stay if its home lies cyclically in (hole, slot]
+        if (((slot - ideal) & mask) < ((slot - hole) & mask)) {
+            continue;
+        }
+        entries[hole].page_id.store(moved_id, std::memory_order_relaxed);
+        entries[hole].frame.store(
+            entries[slot].frame.load(std::memory_order_relaxed),
+            std::memory_order_relaxed);
+        hole = slot;
+    }
+    entries[hole].frame.store(0, std::memory_order_relaxed);
+}
+
+} // namespace moderndbs
@@ -0,0 +1,452 @@
+#include "moderndbs/replacement_policy.h"
+#include "moderndbs/buffer_manager.h"
+#include <algorithm>
+#include <array>
+#include <random>
+#include <set>
+#include <tuple>
+#include <unordered_map>
+
+namespace moderndbs {
+
+/// Full 2Q: pages are loaded into a FIFO list (A1in) and stay there no
+/// matter how often they are fixed. The ids of pages evicted from the FIFO
+/// list are remembered in a bounded ghost list (A1out), only a page that is
+/// loaded again while it is remembered is admitted to the LRU list (Am).
+/// Victims are taken from the FIFO list while it holds more than `kin`
+/// pages and from the LRU list otherwise, so pages that are only touched by
+/// a scan never displace the LRU list.
+class TwoQPolicy : public ReplacementPolicy {
+  private:
+    FrameList fifo;
+    FrameList lru;
+
+    // target size of the FIFO list
+    size_t kin;
+
+    // ring of recently evicted page ids from the FIFO list, slots of pages
+    // that were loaded again are stale
+    std::vector<uint64_t> ghosts;
+    size_t ghost_pos = 0;
+
+    // page id -> its slot in ghosts
+    std::unordered_map<uint64_t, size_t> ghost_slots;
+
+    void remember(uint64_t page_id) {
+        auto& slot = ghosts[ghost_pos];
+        auto it = ghost_slots.find(slot);
+        if (it != ghost_slots.end() && it->second == ghost_pos) {
+            // forget the oldest ghost
+            ghost_slots.erase(it);
+        }
+        slot = page_id;
+        ghost_slots[page_id] = ghost_pos;
+        ghost_pos = (ghost_pos + 1) % ghosts.size();
+    }
+
+    /// Returns the lists in the order in which victims are taken from them.
+    std::array<FrameList*, 2> victim_lists() {
+        if (fifo.size() > kin) {
+            return {&fifo, &lru};
+        }
+        return {&lru, &fifo};
+    }
+
+  public:
+    /// The sizes of the FIFO and ghost lists follow the 2Q paper, a quarter
+    /// and half of the frames.
+    explicit TwoQPolicy(size_t page_count)
+        : kin(std::max<size_t>(page_count / 4, 1)),
+          ghosts(std::max<size_t>(page_count / 2, 1)) {
+        ghost_slots.reserve(ghosts.size());
+    }
+
+    void set_page_count(size_t page_count) override {
+        kin = std::max<size_t>(page_count / 4, 1);
+        // the ring is sized anew, the remembered pages are forgotten
+        ghosts.assign(std::max<size_t>(page_count / 2, 1), 0);
+        ghost_pos = 0;
+        ghost_slots.clear();
+    }
+
+    void on_insert(BufferFrame& frame) override {
+        auto it = ghost_slots.find(frame.page_id);
+        if (it != ghost_slots.end()) {
+            // the page was evicted too early, it is hot
+            ghost_slots.erase(it);
+            frame.position = BufferFrame::LRU;
+            lru.push_back(&frame);
+        } else {
+            frame.position = BufferFrame::FIFO;
+            fifo.push_back(&frame);
+        }
+    }
+
+    void on_hit(BufferFrame& frame) override {
+        // fixes of a page in the FIFO list are usually correlated, e.g. by a
+        // scan that reads the page several times, so they do not make it hot
+        if (frame.position == BufferFrame::LRU) {
+            lru.move_to_back(&frame);
+        }
+    }
+
+    void on_remove(BufferFrame& frame) override {
+        if (frame.position == BufferFrame::FIFO) {
+            fifo.remove(&frame);
+            remember(frame.page_id);
+        } else {
+            lru.remove(&frame);
+        }
+        frame.position = BufferFrame::NONE;
+    }
+
+    BufferFrame* pick_victim() override {
+        for (auto* list : victim_lists()) {
+            for (auto* frame = list->front(); frame;
+                 frame = FrameList::next(frame)) {
+                if (frame->try_claim()) {
+                    return frame;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    void collect_victims(size_t count,
+                         std::vector<BufferFrame*>& victims) override {
+        for (auto* list : victim_lists()) {
+            for (auto* frame = list->front(); frame && count > 0;
+                 frame = FrameList::next(frame)) {
+                if (frame->thread_cnt == 0) {
+                    victims.push_back(frame);
+                    --count;
+                }
+            }
+        }
+    }
+
+    void append_fifo_list(std::vector<uint64_t>& page_ids) const override {
+        for (auto* frame = fifo.front(); frame; frame = FrameList::next(frame)) {
+            page_ids.push_back(frame->page_id);
+        }
+    }
+
+    void append_lru_list(std::vector<uint64_t>& page_ids) const override {
+        for (auto* frame = lru.front(); frame; frame = FrameList::next(frame)) {
+            page_ids.push_back(frame->page_id);
+        }
+    }
+};
+
+/// The frames form a ring that a clock hand sweeps over. A hit only sets the
+/// reference bit of the frame, the hand clears the bits it passes and evicts
+/// the first unfixed frame whose bit is already cleared.
+class ClockPolicy : public ReplacementPolicy {
+  private:
+    FrameList ring;
+
+    // the frame the next sweep starts at, nullptr for the front of the ring
+    BufferFrame* hand = nullptr;
+
+    /// Returns the frame after `frame` in the ring.
+    BufferFrame* advance(BufferFrame* frame) const {
+        auto* next = FrameList::next(frame);
+        return next ? next : ring.front();
+    }
+
+  public:
+    void on_insert(BufferFrame& frame) override {
+        // the new page is the last one the hand reaches
+        frame.referenced.store(false, std::memory_order_relaxed);
+        if (hand) {
+            ring.insert_before(hand, &frame);
+        } else {
+            ring.push_back(&frame);
+        }
+    }
+
+    void on_hit(BufferFrame& frame) override {
+        // only write the shared cache line if the bit is not set yet
+        if (!frame.referenced.load(std::memory_order_relaxed)) {
+            frame.referenced.store(true, std::memory_order_relaxed);
+        }
+    }
+
+    [[nodiscard]] bool concurrent_hits() const override { return true; }
+
+    void on_remove(BufferFrame& frame) override {
+        if (hand == &frame) {
+            hand = FrameList::next(&frame);
+        }
+        ring.remove(&frame);
+    }
+
+    BufferFrame* pick_victim() override {
+        if (ring.empty()) {
+            return nullptr;
+        }
+        auto* frame = hand ? hand : ring.front();
+        // after one round all reference bits of unfixed frames are cleared,
+        // so a second round finds a victim unless all frames are fixed
+        for (size_t step = 0; step < 2 * ring.size(); ++step) {
+            auto* next = advance(frame);
+            if (frame->thread_cnt == 0 &&
+                !frame->referenced.exchange(false, std::memory_order_relaxed) &&
+                frame->try_claim()) {
+                hand = next;
+                return frame;
+            }
+            frame = next;
+        }
+        hand = frame;
+        return nullptr;
+    }
+
+    void collect_victims(size_t count,
+                         std::vector<BufferFrame*>& victims) override {
+        if (ring.empty()) {
+            return;
+        }
+        // unreferenced frames are evicted in the first round, referenced ones
+        // in the second
+        auto* start = hand ? hand : ring.front();
+        for (bool referenced : {false, true}) {
+            auto* frame = start;
+            do {
+                if (count == 0) {
+                    return;
+                }
+                if (frame->thread_cnt == 0 &&
+                    frame->referenced.load(std::memory_order_relaxed) == referenced) {
+                    victims.push_back(frame);
+                    --count;
+                }
+                frame = advance(frame);
+            } while (frame != start);
+        }
+    }
+};
+
+/// Tracks the times of the last K fixes of every resident page and evicts
+/// the page whose K-th most recent fix is the oldest. Pages that were fixed
+/// less than K times count as infinitely old and are evicted first, ties are
+/// broken by the most recent fix. The history of a page is dropped when it
+/// is evicted.
+class LruKPolicy : public ReplacementPolicy {
+  private:
+    // (K-th most recent fix, most recent fix, frame), 0 if there is no K-th
+    using Key = std::tuple<uint64_t, uint64_t, BufferFrame*>;
+
+    const size_t k;
+
+    // logical time, incremented on every fix
+    uint64_t now = 0;
+
+    // the last (up to) K fix times of every resident page, oldest first
+    std::unordered_map<BufferFrame*, std::vector<uint64_t>> history;
+
+    // all resident frames in eviction order
+    std::set<Key> order;
+
+    Key key(BufferFrame* frame, const std::vector<uint64_t>& times) const {
+        uint64_t kth = times.size() < k ? 0 : times[times.size() - k];
+        return {kth, times.back(), frame};
+    }
+
+  public:
+    explicit LruKPolicy(size_t page_count, size_t k)
+        : k(std::max<size_t>(k, 1)) {
+        history.reserve(page_count);
+    }
+
+    void on_insert(BufferFrame& frame) override {
+        auto& times = history[&frame];
+        times.assign(1, ++now);
+        order.insert(key(&frame, times));
+    }
+
+    void on_hit(BufferFrame& frame) override {
+        auto& times = history[&frame];
+        order.erase(key(&frame, times));
+        if (times.size() == k) {
+            times.erase(times.begin());
+        }
+        times.push_back(++now);
+        order.insert(key(&frame, times));
+    }
+
+    void on_remove(BufferFrame& frame) override {
+        auto it = history.find(&frame);
+        order.erase(key(&frame, it->second));
+        history.erase(it);
+    }
+
+    BufferFrame* pick_victim() override {
+        for (const auto& entry : order) {
+            auto* frame = std::get<2>(entry);
+            if (frame->try_claim()) {
+                return frame;
+            }
+        }
+        return nullptr;
+    }
+
+    void collect_victims(size_t count,
+                         std::vector<BufferFrame*>& victims) override {
+        for (auto it = order.begin(); it != order.end() && count > 0; ++it) {
+            auto* frame = std::get<2>(*it);
+            if (frame->thread_cnt == 0) {
+                victims.push_back(frame);
+                --count;
+            }
+        }
+    }
+};
+
+/// Cooling stage in the style of LeanStore. Resident pages are hot, and a
+/// hit on a hot page only reads its reference bit, which stays set while
+/// the page is hot. To find victims, unfixed hot frames are chosen at random
+/// and moved to the end of a FIFO cooling list of a tenth of the frames with
+/// their bit cleared. A hit on a cooling page sets the bit again, and when
+/// the eviction end of the list reaches such a page, it becomes hot again
+/// instead of being evicted. So only pages that were not hit while they
+/// cooled are evicted, without any bookkeeping on the hot path.
+class CoolingPolicy : public ReplacementPolicy {
+  private:
+    // the hot frames in no particular order, see `BufferFrame::hot_slot`
+    std::vector<BufferFrame*> hot;
+
+    // the cooling frames, the next victim first
+    FrameList cooling;
+
+    // target size of the cooling list
+    size_t cooling_target;
+
+    std::minstd_rand random;
+
+    void make_hot(BufferFrame& frame) {
+        frame.referenced.store(true, std::memory_order_relaxed);
+        frame.position = BufferFrame::HOT;
+        frame.hot_slot = hot.size();
+        hot.push_back(&frame);
+    }
+
+    void remove_hot(BufferFrame& frame) {
+        auto* last = hot.back();
+        hot[frame.hot_slot] = last;
+        last->hot_slot = frame.hot_slot;
+        hot.pop_back();
+    }
+
+    void make_cooling(BufferFrame& frame) {
+        remove_hot(frame);
+        frame.referenced.store(false, std::memory_order_relaxed);
+        frame.position = BufferFrame::COOLING;
+        cooling.push_back(&frame);
+    }
+
+    /// Moves random unfixed hot frames to the cooling list until it holds
+    /// `size` frames.
+    void refill(size_t size) {
+        // fixed frames are skipped, so give up after a few attempts per frame
+        for (size_t attempts = 4 * size;
+             cooling.size() < size && !hot.empty() && attempts > 0;
+             --attempts) {
+            auto* frame = hot[random() % hot.size()];
+            if (frame->thread_cnt == 0) {
+                make_cooling(*frame);
+            }
+        }
+        if (cooling.empty()) {
+            // nearly all frames are fixed, find an unfixed one if there is
+            for (auto* frame : hot) {
+                if (frame->thread_cnt == 0) {
+                    make_cooling(*frame);
+                    break;
+                }
+            }
+        }
+    }
+
+  public:
+    explicit CoolingPolicy(size_t page_count)
+        : cooling_target(std::max<size_t>(page_count / 10, 1)) {
+        hot.reserve(page_count);
+    }
+
+    void on_insert(BufferFrame& frame) override { make_hot(frame); }
+
+    void on_hit(BufferFrame& frame) override {
+        // only cooling frames have the bit cleared, hot ones are just read
+        if (!frame.referenced.load(std::memory_order_relaxed)) {
+            frame.referenced.store(true, std::memory_order_relaxed);
+        }
+    }
+
+    [[nodiscard]] bool concurrent_hits() const override { return true; }
+
+    void on_remove(BufferFrame& frame) override {
+        if (frame.position == BufferFrame::COOLING) {
+            cooling.remove(&frame);
+        } else {
+            remove_hot(frame);
+        }
+        frame.position = BufferFrame::NONE;
+    }
+
+    BufferFrame* pick_victim() override {
+        // frames that are hit while cooling become hot and may be cooled
+        // down again by the second round
+        for (size_t round = 0; round < 2; ++round) {
+            // one frame more than the target, so that the frames that stay
+            // behind the victim had the time of at least one miss to be hit
+            refill(cooling_target + 1);
+            for (auto* frame = cooling.front(); frame;) {
+                auto* next = FrameList::next(frame);
+                if (frame->referenced.load(std::memory_order_relaxed)) {
+                    cooling.remove(frame);
+                    make_hot(*frame);
+                } else if (frame->try_claim()) {
+                    return frame;
+                }
+                frame = next;
+            }
+        }
+        return nullptr;
+    }
+
+    void collect_victims(size_t count,
+                         std::vector<BufferFrame*>& victims) override {
+        refill(cooling_target);
+        for (auto* frame = cooling.front(); frame && count > 0;
+             frame = FrameList::next(frame)) {
+            if (frame->thread_cnt == 0 &&
+                !frame->referenced.load(std::memory_order_relaxed)) {
+                victims.push_back(frame);
+                --count;
+            }
+        }
+    }
+
+    void set_page_count(size_t page_count) override {
+        cooling_target = std::max<size_t>(page_count / 10, 1);
+    }
+};
+
+std::unique_ptr<ReplacementPolicy>
+ReplacementPolicy::create(ReplacementStrategy strategy, size_t page_count,
+                          size_t k) {
+    switch (strategy) {
+        case ReplacementStrategy::Clock:
+            return std::make_unique<ClockPolicy>();
+        case ReplacementStrategy::LruK:
+            return std::make_unique<LruKPolicy>(page_count, k);
+        case ReplacementStrategy::Cooling:
+            return std::make_unique<CoolingPolicy>(page_count);
+        case ReplacementStrategy::TwoQ:
+            break;
+    }
+    return std::make_unique<TwoQPolicy>(page_count);
+}
+
+} // namespace moderndbs
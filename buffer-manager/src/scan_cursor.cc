@@ -0,0 +1,46 @@
+#include "moderndbs/scan_cursor.h"
+#include <algorithm>
+
+namespace moderndbs {
+
+ScanCursor::ScanCursor(BufferManager& buffer_manager, uint16_t segment_id,
+                       uint64_t begin, uint64_t end, size_t ring_size,
+                       size_t read_ahead)
+    : buffer_manager(buffer_manager),
+      segment_bits(static_cast<uint64_t>(segment_id) << 48), next_page(begin),
+      end_page(std::max(begin, end)),
+      // the current page and the pages in flight must fit into the ring
+      read_ahead(std::min(read_ahead, std::max<size_t>(ring_size, 1) - 1)),
+      read_ahead_end(begin) {
+    ring.capacity = std::max<size_t>(ring_size, 1);
+    ring.slots.reserve(ring.capacity + 1);
+}
+
+ScanCursor::~ScanCursor() {
+    if (current) {
+        buffer_manager.unfix_page(*current, false);
+    }
+}
+
+const char* ScanCursor::next() {
+    if (current) {
+        buffer_manager.unfix_page(*current, false);
+        current = nullptr;
+    }
+    if (next_page >= end_page) {
+        return nullptr;
+    }
+    current_page = segment_bits | next_page++;
+    current = &buffer_manager.fix_scan_page(current_page, ring);
+    // the current page is fixed, so the read-ahead cannot recycle its frame
+    read_ahead_end = std::max(read_ahead_end, next_page);
+    auto read_ahead_limit = std::min(end_page, next_page + read_ahead);
+    for (; read_ahead_end < read_ahead_limit; ++read_ahead_end) {
+        buffer_manager.prefetch_page(segment_bits | read_ahead_end, &ring);
+    }
+    return current->get_data();
+}
+
+uint64_t ScanCursor::page_id() const { return current_page; }
+
+} // namespace moderndbs
@@ -0,0 +1,70 @@
+#include "moderndbs/segment_file_cache.h"
+#include <string>
+#include <vector>
+
+namespace moderndbs {
+
+SegmentFileCache::SegmentFileCache(size_t capacity, File::IOMode io_mode)
+    : capacity(capacity), io_mode(io_mode) {}
+
+std::shared_ptr<File> SegmentFileCache::get(uint16_t segment_id) {
+    if (capacity == 0) {
+        return File::open_file(std::to_string(segment_id).c_str(), File::WRITE,
+                               io_mode);
+    }
+
+    std::lock_guard<std::mutex> cache_lock(latch);
+    if (auto it = files.find(segment_id); it != files.end()) {
+        lru.splice(lru.end(), lru, it->second.lru_pos);
+        return it->second.file;
+    }
+
+    if (files.size() >= capacity) {
+        // close the least recently used file nobody is doing I/O on, if all
+        // are in use the least recently used one is closed by its last user
+        auto victim = lru.begin();
+        for (auto it = lru.begin(); it != lru.end(); ++it) {
+            if (files[*it].file.use_count() == 1) {
+                victim = it;
+                break;
+            }
+        }
+        files.erase(*victim);
+        lru.erase(victim);
+    }
+
+    std::shared_ptr<File> file = File::open_file(
+        std::to_string(segment_id).c_str(), File::WRITE, io_mode);
+    auto lru_pos = lru.insert(lru.end(), segment_id);
+    files.emplace(segment_id, Entry{file, lru_pos});
+    return file;
+}
+
+void SegmentFileCache::mark_written(uint16_t segment_id) {
+    std::lock_guard<std::mutex> cache_lock(latch);
+    written_segments.insert(segment_id);
+}
+
+void SegmentFileCache::sync() {
+    std::vector<uint16_t> segments;
+    {
+        std::lock_guard<std::mutex> cache_lock(latch);
+        segments.assign(written_segments.begin(), written_segments.end());
+        written_segments.clear();
+    }
+    // syncing a file flushes the writes of all descriptors of it, also of
+    // the ones that were closed in the meantime
+    for (auto it = segments.begin(); it != segments.end(); ++it) {
+        try {
+            get(*it)->sync();
+        } catch (...) {
+            // the failed segment and the ones not synced yet stay written,
+            // so that the next sync retries them
+            std::lock_guard<std::mutex> cache_lock(latch);
+            written_segments.insert(it, segments.end());
+            throw;
+        }
+    }
+}
+
+} // namespace moderndbs
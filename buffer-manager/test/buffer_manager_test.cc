@@ -1,11 +1,25 @@
 #include "moderndbs/buffer_manager.h"
+#include "moderndbs/file.h"
+#include "moderndbs/log_manager.h"
+#include "moderndbs/mmap_buffer_manager.h"
+#include "moderndbs/numa.h"
+#include "moderndbs/page_guard.h"
+#include "moderndbs/page_table.h"
+#include "moderndbs/scan_cursor.h"
+#include "moderndbs/segment_file_cache.h"
 #include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdio>
 #include <cstring>
+#include <filesystem>
 #include <gtest/gtest.h>
+#include <map>
 #include <mutex>
 #include <random>
+#include <sched.h>
+#include <sstream>
 #include <thread>
 #include <vector>
 
@@ -14,6 +28,7 @@ namespace {
 // NOLINTNEXTLINE
 TEST(BufferManagerTest, FixSingle) {
     moderndbs::BufferManager buffer_manager{1024, 10};
+    EXPECT_EQ(1024, buffer_manager.get_page_size());
     std::vector<uint64_t> expected_values(1024 / sizeof(uint64_t), 123);
     {
         auto& page = buffer_manager.fix_page(1, true);
@@ -28,8 +43,8 @@ TEST(BufferManagerTest, FixSingle) {
         auto& page = buffer_manager.fix_page(1, false);
         std::memcpy(values.data(), page.get_data(), 1024);
         buffer_manager.unfix_page(page, true);
-        EXPECT_TRUE(buffer_manager.get_fifo_list().empty());
-        EXPECT_EQ(std::vector<uint64_t>{1}, buffer_manager.get_lru_list());
+        EXPECT_EQ(std::vector<uint64_t>{1}, buffer_manager.get_fifo_list());
+        EXPECT_TRUE(buffer_manager.get_lru_list().empty());
         ASSERT_EQ(expected_values, values);
     }
 }
@@ -104,42 +119,1028 @@ TEST(BufferManagerTest, BufferFull) {
 }
 
 
+// NOLINTNEXTLINE
+TEST(BufferManagerTest, BufferFullWait) {
+    moderndbs::BufferManager buffer_manager{1024, 1};
+    auto& page = buffer_manager.fix_page(1, false);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(20);
+    EXPECT_EQ(nullptr, buffer_manager.fix_page_wait(2, moderndbs::AccessMode::Shared, deadline));
+    EXPECT_EQ(1, buffer_manager.get_wait_stats().timeouts);
+    std::thread unfixer{[&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        buffer_manager.unfix_page(page, false);
+    }};
+    auto* other_page = buffer_manager.fix_page_wait(2, moderndbs::AccessMode::Shared);
+    unfixer.join();
+    ASSERT_NE(nullptr, other_page);
+    buffer_manager.unfix_page(*other_page, false);
+    auto stats = buffer_manager.get_wait_stats();
+    EXPECT_EQ(2, stats.waits);
+    EXPECT_EQ(1, stats.timeouts);
+    EXPECT_GE(stats.wait_time, std::chrono::milliseconds(20));
+}
+
+
 // NOLINTNEXTLINE
 TEST(BufferManagerTest, MoveToLRU) {
     moderndbs::BufferManager buffer_manager{1024, 10};
-    auto& fifo_page = buffer_manager.fix_page(1, false);
-    auto* lru_page = &buffer_manager.fix_page(2, false);
-    buffer_manager.unfix_page(fifo_page, false);
-    buffer_manager.unfix_page(*lru_page, false);
+    auto fix = [&](uint64_t page_id) {
+        buffer_manager.unfix_page(buffer_manager.fix_page(page_id, false), false);
+    };
+    fix(1);
+    fix(2);
+    // a page that is fixed again while in the FIFO list stays there
+    fix(2);
     EXPECT_EQ((std::vector<uint64_t>{1, 2}), buffer_manager.get_fifo_list());
     EXPECT_TRUE(buffer_manager.get_lru_list().empty());
-    lru_page = &buffer_manager.fix_page(2, false);
-    buffer_manager.unfix_page(*lru_page, false);
-    EXPECT_EQ(std::vector<uint64_t>{1}, buffer_manager.get_fifo_list());
-    EXPECT_EQ(std::vector<uint64_t>{2}, buffer_manager.get_lru_list());
+    // page 1 is evicted from the FIFO list and loaded again while it is
+    // remembered
+    for (uint64_t page_id = 3; page_id < 12; ++page_id) {
+        fix(page_id);
+    }
+    fix(1);
+    EXPECT_EQ((std::vector<uint64_t>{3, 4, 5, 6, 7, 8, 9, 10, 11}),
+              buffer_manager.get_fifo_list());
+    EXPECT_EQ(std::vector<uint64_t>{1}, buffer_manager.get_lru_list());
 }
 
 
 // NOLINTNEXTLINE
 TEST(BufferManagerTest, LRURefresh) {
     moderndbs::BufferManager buffer_manager{1024, 10};
-    auto* page1 = &buffer_manager.fix_page(1, false);
-    buffer_manager.unfix_page(*page1, false);
-    page1 = &buffer_manager.fix_page(1, false);
-    buffer_manager.unfix_page(*page1, false);
-    auto* page2 = &buffer_manager.fix_page(2, false);
-    buffer_manager.unfix_page(*page2, false);
-    page2 = &buffer_manager.fix_page(2, false);
-    buffer_manager.unfix_page(*page2, false);
-    EXPECT_TRUE(buffer_manager.get_fifo_list().empty());
+    auto fix = [&](uint64_t page_id) {
+        buffer_manager.unfix_page(buffer_manager.fix_page(page_id, false), false);
+    };
+    // pages 1 and 2 are evicted from the FIFO list and admitted to the LRU
+    // list when they are loaded again
+    for (uint64_t page_id = 1; page_id < 13; ++page_id) {
+        fix(page_id);
+    }
+    fix(1);
+    fix(2);
+    EXPECT_EQ((std::vector<uint64_t>{5, 6, 7, 8, 9, 10, 11, 12}),
+              buffer_manager.get_fifo_list());
     EXPECT_EQ((std::vector<uint64_t>{1, 2}), buffer_manager.get_lru_list());
-    page1 = &buffer_manager.fix_page(1, false);
-    buffer_manager.unfix_page(*page1, false);
-    EXPECT_TRUE(buffer_manager.get_fifo_list().empty());
+    fix(1);
     EXPECT_EQ((std::vector<uint64_t>{2, 1}), buffer_manager.get_lru_list());
 }
 
 
+// NOLINTNEXTLINE
+TEST(BufferManagerTest, PageTable) {
+    moderndbs::PageTable page_table{1000};
+    std::vector<uint64_t> page_ids;
+    std::mt19937_64 engine{0};
+    for (uint32_t i = 0; i < 1000; ++i) {
+        // dense page ids of a few segments plus random ones
+        page_ids.push_back(i % 2 ? engine() : (uint64_t{i % 3} << 48) | i);
+        page_table.insert(page_ids.back(), i);
+    }
+    for (uint32_t i = 0; i < 1000; i += 2) {
+        page_table.erase(page_ids[i]);
+    }
+    for (uint32_t i = 0; i < 1000; ++i) {
+        EXPECT_EQ(i % 2 ? i : moderndbs::PageTable::not_found, page_table.find(page_ids[i]));
+    }
+}
+
+
+// NOLINTNEXTLINE
+TEST(BufferManagerTest, PageGuards) {
+    const uint64_t page_id = uint64_t{11} << 48;
+    std::random_device random;
+    const uint64_t value = random();
+    {
+        moderndbs::BufferManager buffer_manager{1024, 2};
+        moderndbs::SharedPageGuard shared_guard{buffer_manager, page_id};
+        auto exclusive_guard = shared_guard.try_upgrade();
+        EXPECT_TRUE(exclusive_guard);
+        EXPECT_FALSE(shared_guard);
+        *reinterpret_cast<uint64_t*>(exclusive_guard.get_data()) = value;
+        shared_guard = exclusive_guard.downgrade();
+        EXPECT_FALSE(exclusive_guard);
+        EXPECT_EQ(value, *reinterpret_cast<const uint64_t*>(shared_guard.get_data()));
+        // the page is fixed twice now and unfixed by the guards
+        moderndbs::OptimisticPageGuard optimistic_guard{buffer_manager, page_id};
+        EXPECT_EQ(shared_guard.get_data(), optimistic_guard.get_data());
+    }
+    // the page was marked dirty through the exclusive guard
+    moderndbs::BufferManager buffer_manager{1024, 2};
+    moderndbs::SharedPageGuard guard{buffer_manager, page_id};
+    EXPECT_EQ(value, *reinterpret_cast<const uint64_t*>(guard.get_data()));
+}
+
+
+// NOLINTNEXTLINE
+TEST(BufferManagerTest, UpgradeWaitsForReaders) {
+    const uint64_t page_id = uint64_t{33} << 48;
+    std::remove("33");
+    moderndbs::BufferManager buffer_manager{1024, 2};
+    moderndbs::SharedPageGuard upgrader{buffer_manager, page_id};
+    moderndbs::SharedPageGuard reader{buffer_manager, page_id};
+    std::atomic<bool> started = false;
+    std::atomic<bool> upgraded = false;
+    std::thread thread([&] {
+        started = true;
+        auto guard = upgrader.try_upgrade();
+        EXPECT_TRUE(guard);
+        upgraded = true;
+        *reinterpret_cast<uint64_t*>(guard.get_data()) = 1;
+    });
+    while (!started) {
+        std::this_thread::yield();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    // the upgrade keeps its shared latch until the other reader is gone
+    EXPECT_FALSE(upgraded);
+    EXPECT_EQ(0, *reinterpret_cast<const uint64_t*>(reader.get_data()));
+    reader.release();
+    thread.join();
+    EXPECT_TRUE(upgraded);
+    EXPECT_FALSE(upgrader);
+    moderndbs::SharedPageGuard guard{buffer_manager, page_id};
+    EXPECT_EQ(1, *reinterpret_cast<const uint64_t*>(guard.get_data()));
+}
+
+
+// NOLINTNEXTLINE
+TEST(BufferManagerTest, ScanCursorRing) {
+    const uint64_t scan_segment = uint64_t{12} << 48;
+    {
+        moderndbs::BufferManager buffer_manager{1024, 10};
+        for (uint64_t i = 0; i < 200; ++i) {
+            auto& page = buffer_manager.fix_page(scan_segment | i, true);
+            *reinterpret_cast<uint64_t*>(page.get_data()) = i;
+            buffer_manager.unfix_page(page, true);
+        }
+    }
+    moderndbs::BufferManager buffer_manager{1024, 40};
+    auto fix = [&](uint64_t page_id) {
+        buffer_manager.unfix_page(buffer_manager.fix_page(page_id, false), false);
+    };
+    for (uint64_t i = 0; i < 40; ++i) {
+        fix(i);
+    }
+    {
+        moderndbs::ScanCursor cursor{buffer_manager, 12, 0, 200, 8, 4};
+        uint64_t expected = 0;
+        while (const char* data = cursor.next()) {
+            EXPECT_EQ(scan_segment | expected, cursor.page_id());
+            EXPECT_EQ(expected, *reinterpret_cast<const uint64_t*>(data));
+            ++expected;
+        }
+        EXPECT_EQ(200, expected);
+    }
+    // the scan only displaced as many pages as its ring holds
+    auto fifo = buffer_manager.get_fifo_list();
+    EXPECT_EQ(32, std::count_if(fifo.begin(), fifo.end(), [](uint64_t page_id) { return page_id < 40; }));
+}
+
+
+// NOLINTNEXTLINE
+TEST(BufferManagerTest, SequentialReadAhead) {
+    const uint64_t segment = uint64_t{13} << 48;
+    {
+        moderndbs::BufferManager buffer_manager{1024, 10};
+        for (uint64_t i = 0; i < 100; ++i) {
+            auto& page = buffer_manager.fix_page(segment | i, true);
+            *reinterpret_cast<uint64_t*>(page.get_data()) = i;
+            buffer_manager.unfix_page(page, true);
+        }
+    }
+    moderndbs::BufferManagerOptions options;
+    options.max_read_ahead = 16;
+    moderndbs::BufferManager buffer_manager{1024, 32, options};
+    // strided accesses are not read ahead
+    for (uint64_t i = 0; i < 100; i += 2) {
+        buffer_manager.unfix_page(buffer_manager.fix_page(segment | i, false), false);
+    }
+    EXPECT_EQ(0, buffer_manager.get_prefetch_stats().issued);
+    auto misses = buffer_manager.get_miss_count();
+    for (uint64_t i = 0; i < 100; ++i) {
+        auto& page = buffer_manager.fix_page(segment | i, false);
+        EXPECT_EQ(i, *reinterpret_cast<const uint64_t*>(page.get_data()));
+        buffer_manager.unfix_page(page, false);
+    }
+    auto stats = buffer_manager.get_prefetch_stats();
+    EXPECT_GT(stats.used, 50);
+    EXPECT_LE(stats.used + stats.wasted, stats.issued);
+    EXPECT_LT(buffer_manager.get_miss_count() - misses, 10);
+}
+
+
+// NOLINTNEXTLINE
+TEST(BufferManagerTest, ReadAheadOfWrittenSegment) {
+    const uint64_t segment = uint64_t{31} << 48;
+    std::remove("31");
+    moderndbs::BufferManagerOptions options;
+    options.max_read_ahead = 16;
+    moderndbs::BufferManager buffer_manager{1024, 32, options};
+    // the segment file is created and grown by this instance
+    for (uint64_t i = 0; i < 128; ++i) {
+        auto& page = buffer_manager.fix_page(segment | i, true);
+        *reinterpret_cast<uint64_t*>(page.get_data()) = i;
+        buffer_manager.unfix_page(page, true);
+    }
+    buffer_manager.flush_all();
+    for (uint64_t i = 0; i < 128; ++i) {
+        auto& page = buffer_manager.fix_page(segment | i, false);
+        EXPECT_EQ(i, *reinterpret_cast<const uint64_t*>(page.get_data()));
+        buffer_manager.unfix_page(page, false);
+    }
+    auto stats = buffer_manager.get_prefetch_stats();
+    EXPECT_GT(stats.used, 50);
+    EXPECT_LE(stats.used + stats.wasted, stats.issued);
+}
+
+
+// NOLINTNEXTLINE
+TEST(BufferManagerTest, Statistics) {
+    const uint64_t first_segment = uint64_t{15} << 48;
+    const uint64_t second_segment = uint64_t{16} << 48;
+    std::ostringstream dump;
+    {
+        moderndbs::BufferManagerOptions options;
+        options.stats_interval = std::chrono::milliseconds(1);
+        options.stats_stream = &dump;
+        // only write the evicted page
+        options.max_write_pages = 1;
+        moderndbs::BufferManager buffer_manager{1024, 4, options};
+        auto fix = [&](uint64_t page_id, bool exclusive) {
+            buffer_manager.unfix_page(buffer_manager.fix_page(page_id, exclusive), exclusive);
+        };
+        fix(first_segment | 0, true);
+        fix(first_segment | 1, true);
+        fix(second_segment | 0, false);
+        // the counters of a thread outlive it
+        std::thread([&] {
+            fix(first_segment | 0, false);
+            fix(second_segment | 1, false);
+            // evicts the dirty page 1 of the first segment
+            fix(second_segment | 2, false);
+        }).join();
+        auto stats = buffer_manager.stats();
+        EXPECT_EQ(1, stats.hits);
+        EXPECT_EQ(5, stats.misses);
+        EXPECT_DOUBLE_EQ(1.0 / 6, stats.hit_ratio());
+        EXPECT_EQ(1, stats.evictions);
+        EXPECT_EQ(1, stats.dirty_writes);
+        EXPECT_EQ(4, stats.resident_pages);
+        EXPECT_EQ(1, stats.dirty_pages);
+        EXPECT_EQ((std::map<uint16_t, size_t>{{15, 1}, {16, 3}}), stats.segment_pages);
+        size_t histogram_misses = 0;
+        for (auto misses : stats.miss_latency) {
+            histogram_misses += misses;
+        }
+        EXPECT_EQ(5, histogram_misses);
+        EXPECT_GT(stats.miss_latency_quantile(1.0).count(), 0);
+        EXPECT_LE(stats.miss_latency_quantile(0.5), stats.miss_latency_quantile(1.0));
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    EXPECT_NE(std::string::npos, dump.str().find("hits=1 misses=5"));
+}
+
+
+// NOLINTNEXTLINE
+TEST(BufferManagerTest, WriteCoalescing) {
+    auto file = moderndbs::File::make_temporary_file();
+    std::vector<char> first(16, 'a'), second(16, 'b'), third(16, 'c');
+    std::vector<const char*> blocks{first.data(), second.data(), third.data()};
+    file->write_blocks(blocks, 16, 16);
+    std::vector<char> content(48);
+    file->read_block(16, 48, content.data());
+    EXPECT_EQ(std::string(16, 'a') + std::string(16, 'b') + std::string(16, 'c'), std::string(content.begin(), content.end()));
+
+    const uint64_t segment = uint64_t{17} << 48;
+    auto write = [&](moderndbs::BufferManager& buffer_manager, uint64_t page_id) {
+        auto& page = buffer_manager.fix_page(segment | page_id, true);
+        *reinterpret_cast<uint64_t*>(page.get_data()) = page_id + 1;
+        buffer_manager.unfix_page(page, true);
+    };
+    {
+        moderndbs::BufferManager buffer_manager{1024, 4};
+        for (uint64_t page_id = 0; page_id < 4; ++page_id) {
+            write(buffer_manager, page_id);
+        }
+        // evicting page 0 writes its dirty neighbours along
+        buffer_manager.unfix_page(buffer_manager.fix_page(segment | 10, false), false);
+        auto stats = buffer_manager.stats();
+        EXPECT_EQ(4, stats.dirty_writes);
+        EXPECT_EQ(1, stats.write_requests);
+        EXPECT_EQ(0, stats.dirty_pages);
+    }
+    {
+        moderndbs::BufferManager buffer_manager{1024, 8};
+        for (uint64_t page_id = 20; page_id < 26; ++page_id) {
+            if (page_id == 22) {
+                buffer_manager.unfix_page(buffer_manager.fix_page(segment | page_id, false), false);
+            } else {
+                write(buffer_manager, page_id);
+            }
+        }
+        // the clean page splits the dirty pages into two runs
+        buffer_manager.flush_all();
+        auto stats = buffer_manager.stats();
+        EXPECT_EQ(5, stats.dirty_writes);
+        EXPECT_EQ(2, stats.write_requests);
+    }
+    moderndbs::BufferManager buffer_manager{1024, 16};
+    for (uint64_t page_id : {0, 1, 2, 3, 20, 21, 23, 24, 25}) {
+        auto& page = buffer_manager.fix_page(segment | page_id, false);
+        EXPECT_EQ(page_id + 1, *reinterpret_cast<const uint64_t*>(page.get_data()));
+        buffer_manager.unfix_page(page, false);
+    }
+}
+
+
+// NOLINTNEXTLINE
+TEST(BufferManagerTest, GhostListAdmission) {
+    moderndbs::BufferManager buffer_manager{1024, 4};
+    auto fix = [&](uint64_t page_id) {
+        buffer_manager.unfix_page(buffer_manager.fix_page(page_id, false), false);
+    };
+    for (uint64_t page_id = 1; page_id < 6; ++page_id) {
+        fix(page_id);
+    }
+    // page 1 was evicted from the FIFO list and is still remembered
+    fix(1);
+    EXPECT_EQ((std::vector<uint64_t>{3, 4, 5}), buffer_manager.get_fifo_list());
+    EXPECT_EQ(std::vector<uint64_t>{1}, buffer_manager.get_lru_list());
+    // a scan only cycles through the FIFO list
+    for (uint64_t page_id = 100; page_id < 200; ++page_id) {
+        fix(page_id);
+    }
+    EXPECT_EQ((std::vector<uint64_t>{197, 198, 199}), buffer_manager.get_fifo_list());
+    EXPECT_EQ(std::vector<uint64_t>{1}, buffer_manager.get_lru_list());
+}
+
+
+// NOLINTNEXTLINE
+TEST(BufferManagerTest, ClockSecondChance) {
+    moderndbs::BufferManagerOptions options;
+    options.replacement = moderndbs::ReplacementStrategy::Clock;
+    moderndbs::BufferManager buffer_manager{1024, 3, options};
+    auto fix = [&](uint64_t page_id) {
+        buffer_manager.unfix_page(buffer_manager.fix_page(page_id, false), false);
+    };
+    for (uint64_t page_id : {1, 2, 3, 1}) {
+        fix(page_id);
+    }
+    EXPECT_EQ(3, buffer_manager.get_miss_count());
+    EXPECT_EQ(1, buffer_manager.get_hit_count());
+    // page 1 was referenced again, so page 2 is evicted instead
+    fix(4);
+    fix(1);
+    fix(3);
+    EXPECT_EQ(3, buffer_manager.get_hit_count());
+    fix(2);
+    EXPECT_EQ(5, buffer_manager.get_miss_count());
+    EXPECT_TRUE(buffer_manager.get_fifo_list().empty());
+    EXPECT_TRUE(buffer_manager.get_lru_list().empty());
+}
+
+
+// NOLINTNEXTLINE
+TEST(BufferManagerTest, LruKEvictsOldestKthAccess) {
+    moderndbs::BufferManagerOptions options;
+    options.replacement = moderndbs::ReplacementStrategy::LruK;
+    options.lru_k = 2;
+    moderndbs::BufferManager buffer_manager{1024, 2, options};
+    auto fix = [&](uint64_t page_id) {
+        buffer_manager.unfix_page(buffer_manager.fix_page(page_id, false), false);
+    };
+    for (uint64_t page_id : {1, 2, 2, 1}) {
+        fix(page_id);
+    }
+    // page 1 was used last but its second to last use is older than page 2's
+    fix(3);
+    fix(2);
+    EXPECT_EQ(3, buffer_manager.get_hit_count());
+    fix(1);
+    EXPECT_EQ(4, buffer_manager.get_miss_count());
+}
+
+
+// NOLINTNEXTLINE
+TEST(BufferManagerTest, CoolingEvictsUntouchedPages) {
+    moderndbs::BufferManagerOptions options;
+    options.replacement = moderndbs::ReplacementStrategy::Cooling;
+    // 20 frames, two of them cooling at a time
+    moderndbs::BufferManager buffer_manager{1024, 20, options};
+    auto fix = [&](uint64_t page_id) {
+        buffer_manager.unfix_page(buffer_manager.fix_page(page_id, false), false);
+    };
+    for (uint64_t page_id = 0; page_id < 20; ++page_id) {
+        fix(page_id);
+    }
+    {
+        // the first miss fills the cooling stage, page 0 is fixed so that
+        // it is not chosen
+        auto& page = buffer_manager.fix_page(0, false);
+        fix(20);
+        buffer_manager.unfix_page(page, false);
+    }
+    // page 0 is hit after every miss, so whenever it is cooling it becomes
+    // hot again before it reaches the eviction end of the cooling stage
+    for (uint64_t page_id = 21; page_id < 200; ++page_id) {
+        fix(page_id);
+        fix(0);
+    }
+    EXPECT_EQ(200, buffer_manager.get_miss_count());
+    EXPECT_EQ(180, buffer_manager.get_hit_count());
+    EXPECT_EQ(20, buffer_manager.stats().resident_pages);
+    EXPECT_TRUE(buffer_manager.get_fifo_list().empty());
+
+    // fixed pages are never chosen
+    std::vector<moderndbs::BufferFrame*> pages;
+    for (uint64_t page_id = 1000; page_id < 1020; ++page_id) {
+        pages.push_back(&buffer_manager.fix_page(page_id, false));
+    }
+    EXPECT_THROW(buffer_manager.fix_page(2000, false), moderndbs::buffer_full_error);
+    for (auto* page : pages) {
+        buffer_manager.unfix_page(*page, false);
+    }
+}
+
+
+// NOLINTNEXTLINE
+TEST(BufferManagerTest, FuzzyCheckpoint) {
+    const uint64_t segment = uint64_t{19} << 48;
+    moderndbs::BufferManagerOptions options;
+    options.partition_count = 4;
+    moderndbs::BufferManager buffer_manager{1024, 64, options};
+    auto increment = [&](uint64_t page_id) {
+        auto& page = buffer_manager.fix_page(segment | page_id, true);
+        ++*reinterpret_cast<uint64_t*>(page.get_data());
+        buffer_manager.unfix_page(page, true);
+    };
+    auto read_from_disk = [](uint64_t page_id) {
+        auto file = moderndbs::File::open_file("19", moderndbs::File::READ);
+        uint64_t value = 0;
+        file->read_block(page_id * 1024, sizeof(value), reinterpret_cast<char*>(&value));
+        return value;
+    };
+    for (uint64_t page_id = 0; page_id < 32; ++page_id) {
+        increment(page_id);
+    }
+    auto base = read_from_disk(5);
+    EXPECT_EQ(32, buffer_manager.checkpoint());
+    EXPECT_EQ(0, buffer_manager.stats().dirty_pages);
+    EXPECT_EQ(0, buffer_manager.checkpoint());
+    // checkpoints run while another thread keeps modifying the pages
+    std::atomic<bool> stop = false;
+    std::thread writer([&] {
+        for (uint64_t i = 0; !stop; ++i) {
+            increment(i % 32);
+        }
+    });
+    for (size_t i = 0; i < 10; ++i) {
+        buffer_manager.checkpoint();
+    }
+    stop = true;
+    writer.join();
+    buffer_manager.checkpoint();
+    EXPECT_EQ(0, buffer_manager.stats().dirty_pages);
+    for (uint64_t page_id : {0, 5, 31}) {
+        auto& page = buffer_manager.fix_page(segment | page_id, false);
+        EXPECT_EQ(*reinterpret_cast<const uint64_t*>(page.get_data()), read_from_disk(page_id));
+        buffer_manager.unfix_page(page, false);
+    }
+    EXPECT_LT(base, read_from_disk(5));
+}
+
+
+// NOLINTNEXTLINE
+TEST(BufferManagerTest, CheckpointWithEviction) {
+    const uint64_t segment = uint64_t{37} << 48;
+    const uint64_t page_count = 32;
+    const size_t writer_count = 4;
+    const uint64_t rounds = 100;
+    std::remove("37");
+    {
+        moderndbs::BufferManagerOptions options;
+        options.target_clean_ratio = 0.5;
+        options.cleaner_interval = std::chrono::milliseconds{1};
+        // the writers, the cleaner and the checkpoint together never fix
+        // all frames
+        options.max_write_pages = 4;
+        // fewer frames than pages, so that modified pages are evicted and
+        // cleaned while checkpoints write their copies
+        moderndbs::BufferManager buffer_manager{1024, 24, options};
+        std::atomic<size_t> writers = writer_count;
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < writer_count; ++t) {
+            threads.emplace_back([&, t] {
+                std::mt19937_64 engine{t};
+                for (uint64_t round = 0; round < rounds; ++round) {
+                    for (uint64_t i = 0; i < page_count; ++i) {
+                        auto page_id = engine() % page_count;
+                        auto& page = buffer_manager.fix_page(segment | page_id, true);
+                        ++*reinterpret_cast<uint64_t*>(page.get_data());
+                        // keeps checkpoints waiting between their copy of a
+                        // page and its write
+                        if (engine() % 8 == 0) {
+                            std::this_thread::sleep_for(std::chrono::microseconds(50));
+                        }
+                        buffer_manager.unfix_page(page, true);
+                    }
+                }
+                writers.fetch_sub(1);
+            });
+        }
+        threads.emplace_back([&] {
+            while (writers > 0) {
+                buffer_manager.checkpoint();
+            }
+        });
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        buffer_manager.checkpoint();
+        EXPECT_EQ(0, buffer_manager.stats().dirty_pages);
+    }
+    // no checkpoint overwrote a newer version of a page with its older copy
+    moderndbs::BufferManager buffer_manager{1024, 16};
+    uint64_t sum = 0;
+    for (uint64_t page_id = 0; page_id < page_count; ++page_id) {
+        auto& page = buffer_manager.fix_page(segment | page_id, false);
+        sum += *reinterpret_cast<const uint64_t*>(page.get_data());
+        buffer_manager.unfix_page(page, false);
+    }
+    EXPECT_EQ(writer_count * rounds * page_count, sum);
+    std::remove("37");
+}
+
+
+// NOLINTNEXTLINE
+TEST(BufferManagerTest, WriteAheadLogRedo) {
+    const uint64_t segment = uint64_t{20} << 48;
+    std::remove("20");
+    std::remove("wal_redo.log");
+    auto set = [](moderndbs::BufferFrame& page, uint64_t value) {
+        std::memcpy(page.get_data() + 8, &value, sizeof(value));
+    };
+    auto get = [](const moderndbs::BufferFrame& page) {
+        uint64_t value = 0;
+        std::memcpy(&value, page.get_data() + 8, sizeof(value));
+        return value;
+    };
+    {
+        // a crash after the commits, before any page was written
+        moderndbs::LogManager log{"wal_redo.log"};
+        for (uint64_t page_id = 0; page_id < 4; ++page_id) {
+            uint64_t value = page_id + 100;
+            log.flush(log.append(segment | page_id, 8, {reinterpret_cast<const char*>(&value), sizeof(value)}));
+        }
+    }
+    {
+        // a torn record at the end of the log
+        auto file = moderndbs::File::open_file("wal_redo.log", moderndbs::File::WRITE);
+        std::vector<char> garbage(10, 'x');
+        file->write_block(garbage.data(), file->size(), garbage.size());
+    }
+    {
+        moderndbs::LogManager log{"wal_redo.log"};
+        moderndbs::BufferManagerOptions options;
+        options.log = &log;
+        options.io_mode = moderndbs::File::BUFFERED;
+        moderndbs::BufferManager buffer_manager{1024, 2, options};
+        for (uint64_t page_id = 0; page_id < 4; ++page_id) {
+            auto& page = buffer_manager.fix_page(segment | page_id, false);
+            EXPECT_EQ(page_id + 100, get(page));
+            buffer_manager.unfix_page(page, false);
+        }
+        // the write-ahead rule holds for evicted pages
+        auto& page = buffer_manager.fix_page(segment | 0, true);
+        set(page, 7);
+        auto lsn = buffer_manager.log_update(page, 8, sizeof(uint64_t));
+        buffer_manager.unfix_page(page, true);
+        EXPECT_LT(log.get_flushed_lsn(), lsn);
+        for (uint64_t page_id = 1; page_id < 4; ++page_id) {
+            buffer_manager.unfix_page(buffer_manager.fix_page(segment | page_id, false), false);
+        }
+        EXPECT_GE(log.get_flushed_lsn(), lsn);
+    }
+    // the pages were written on shutdown, nothing is left to redo
+    moderndbs::LogManager log{"wal_redo.log"};
+    EXPECT_EQ(0, log.redo([](uint64_t, uint32_t, std::span<const char>, uint64_t) {}));
+    moderndbs::BufferManager buffer_manager{1024, 2};
+    auto& page = buffer_manager.fix_page(segment | 0, false);
+    EXPECT_EQ(7, get(page));
+    buffer_manager.unfix_page(page, false);
+}
+
+
+// NOLINTNEXTLINE
+TEST(BufferManagerTest, WriteAheadLogGroupCommit) {
+    std::remove("wal_group.log");
+    constexpr size_t thread_count = 8;
+    constexpr size_t commits = 50;
+    {
+        // a small buffer, so that appends also wait for flushes
+        moderndbs::LogManager log{"wal_group.log", 4096};
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < thread_count; ++i) {
+            threads.emplace_back([&log, i] {
+                std::vector<char> data(100, static_cast<char>(i));
+                for (size_t j = 0; j < commits; ++j) {
+                    auto lsn = log.append(i, static_cast<uint32_t>(j), data);
+                    log.flush(lsn);
+                    EXPECT_GE(log.get_flushed_lsn(), lsn);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        EXPECT_LE(log.get_flush_count(), thread_count * commits);
+    }
+    moderndbs::LogManager log{"wal_group.log"};
+    std::vector<size_t> next_commit(thread_count);
+    auto records = log.redo([&](uint64_t page_id, uint32_t offset, std::span<const char> data, uint64_t) {
+        // the records of every thread are in order and intact
+        ASSERT_LT(page_id, thread_count);
+        EXPECT_EQ(next_commit[page_id]++, offset);
+        EXPECT_EQ(100, std::count(data.begin(), data.end(), static_cast<char>(page_id)));
+    });
+    EXPECT_EQ(thread_count * commits, records);
+}
+
+
+// NOLINTNEXTLINE
+TEST(BufferManagerTest, Resize) {
+    const uint64_t segment = uint64_t{22} << 48;
+    moderndbs::BufferManagerOptions options;
+    options.max_page_count = 32;
+    moderndbs::BufferManager buffer_manager{1024, 8, options};
+    auto write = [&](uint64_t page_id) {
+        auto& page = buffer_manager.fix_page(segment | page_id, true);
+        *reinterpret_cast<uint64_t*>(page.get_data()) = page_id + 1;
+        buffer_manager.unfix_page(page, true);
+    };
+    auto check = [&](uint64_t page_id) {
+        auto& page = buffer_manager.fix_page(segment | page_id, false);
+        EXPECT_EQ(page_id + 1, *reinterpret_cast<const uint64_t*>(page.get_data()));
+        buffer_manager.unfix_page(page, false);
+    };
+    for (uint64_t page_id = 0; page_id < 8; ++page_id) {
+        write(page_id);
+    }
+    auto* first_frame = &buffer_manager.fix_page(segment, false);
+    buffer_manager.unfix_page(*first_frame, false);
+    // growing beyond the maximum is clamped, the resident pages stay in place
+    buffer_manager.resize(1000);
+    EXPECT_EQ(32, buffer_manager.get_page_count());
+    for (uint64_t page_id = 8; page_id < 32; ++page_id) {
+        write(page_id);
+    }
+    EXPECT_EQ(0, buffer_manager.stats().evictions);
+    EXPECT_EQ(32, buffer_manager.stats().resident_pages);
+    EXPECT_EQ(first_frame, &buffer_manager.fix_page(segment, false));
+    buffer_manager.unfix_page(*first_frame, false);
+
+    // shrinking waits for fixed pages of the retired frames
+    std::vector<moderndbs::BufferFrame*> fixed;
+    for (uint64_t page_id = 0; page_id < 32; ++page_id) {
+        fixed.push_back(&buffer_manager.fix_page(segment | page_id, false));
+    }
+    std::atomic<bool> resized = false;
+    std::thread resizer([&] {
+        buffer_manager.resize(4);
+        resized = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_FALSE(resized);
+    for (auto* page : fixed) {
+        buffer_manager.unfix_page(*page, false);
+    }
+    resizer.join();
+    EXPECT_EQ(4, buffer_manager.get_page_count());
+    EXPECT_GE(4, buffer_manager.stats().resident_pages);
+    // the evicted pages were written back
+    for (uint64_t page_id = 0; page_id < 32; ++page_id) {
+        check(page_id);
+    }
+    EXPECT_GE(4, buffer_manager.stats().resident_pages);
+    buffer_manager.resize(16);
+    for (uint64_t page_id = 0; page_id < 16; ++page_id) {
+        check(page_id);
+    }
+    EXPECT_EQ(16, buffer_manager.stats().resident_pages);
+}
+
+
+// NOLINTNEXTLINE
+TEST(BufferManagerTest, NumaPlacement) {
+    const auto& topology = moderndbs::NumaTopology::get();
+    ASSERT_LE(1, topology.node_count());
+    EXPECT_GT(topology.node_count(), topology.current_node());
+    const uint64_t segment = uint64_t{23} << 48;
+    moderndbs::BufferManagerOptions options;
+    options.partition_count = 2;
+    options.target_clean_ratio = 0.5;
+    options.numa_aware = true;
+    options.cleaner_node = 0;
+    moderndbs::BufferManager buffer_manager{1024, 16, options};
+    // the test thread is pinned below, the later tests run unpinned again
+    cpu_set_t affinity;
+    sched_getaffinity(0, sizeof(affinity), &affinity);
+    // the pool works no matter which node the pages are missed on
+    for (unsigned node = 0; node < topology.node_count(); ++node) {
+        EXPECT_TRUE(topology.pin_thread(node));
+        for (uint64_t page_id = 0; page_id < 64; ++page_id) {
+            auto& page = buffer_manager.fix_page(segment | page_id, true);
+            *reinterpret_cast<uint64_t*>(page.get_data()) = page_id + node;
+            buffer_manager.unfix_page(page, true);
+        }
+        auto& page = buffer_manager.fix_page(segment | 3, false);
+        EXPECT_EQ(3 + node, *reinterpret_cast<const uint64_t*>(page.get_data()));
+        buffer_manager.unfix_page(page, false);
+    }
+    sched_setaffinity(0, sizeof(affinity), &affinity);
+}
+
+
+// NOLINTNEXTLINE
+TEST(BufferManagerTest, HugePagePool) {
+    const uint64_t segment = uint64_t{24} << 48;
+    for (bool huge_pages : {false, true}) {
+        moderndbs::BufferManagerOptions options;
+        options.huge_pages = huge_pages;
+        options.max_page_count = 1024;
+        // 4 MiB of 4 KiB pages, explicit huge pages are only used if the
+        // machine has them configured
+        moderndbs::BufferManager buffer_manager{4096, 512, options};
+        auto pool_page_size = buffer_manager.get_pool_page_size();
+        EXPECT_TRUE(pool_page_size == 4096 || (huge_pages && pool_page_size == 2 << 20));
+        for (uint64_t page_id = 0; page_id < 1024; ++page_id) {
+            auto& page = buffer_manager.fix_page(segment | page_id, true);
+            EXPECT_EQ(0, reinterpret_cast<uintptr_t>(page.get_data()) % 4096);
+            *reinterpret_cast<uint64_t*>(page.get_data()) = page_id;
+            buffer_manager.unfix_page(page, true);
+        }
+        buffer_manager.resize(1024);
+        buffer_manager.resize(256);
+        for (uint64_t page_id = 0; page_id < 1024; page_id += 7) {
+            auto& page = buffer_manager.fix_page(segment | page_id, false);
+            EXPECT_EQ(page_id, *reinterpret_cast<const uint64_t*>(page.get_data()));
+            buffer_manager.unfix_page(page, false);
+        }
+    }
+}
+
+
+// NOLINTNEXTLINE
+TEST(BufferManagerTest, FixPages) {
+    const uint64_t segment = uint64_t{25} << 48;
+    std::remove("25");
+    moderndbs::BufferManagerOptions options;
+    options.partition_count = 2;
+    moderndbs::BufferManager buffer_manager{1024, 16, options};
+    auto& resident = buffer_manager.fix_page(segment | 3, true);
+    *reinterpret_cast<uint64_t*>(resident.get_data()) = 42;
+    buffer_manager.unfix_page(resident, true);
+
+    // page 3 is a hit, the others are missed, page 5 is given twice
+    auto hits = buffer_manager.get_hit_count();
+    auto misses = buffer_manager.get_miss_count();
+    std::vector<uint64_t> page_ids{segment | 5, segment | 3, segment | 7, segment | 5};
+    auto frames = buffer_manager.fix_pages(page_ids, moderndbs::AccessMode::Exclusive);
+    ASSERT_EQ(4, frames.size());
+    EXPECT_EQ(frames[0], frames[3]);
+    EXPECT_EQ(&resident, frames[1]);
+    EXPECT_EQ(42, *reinterpret_cast<uint64_t*>(frames[1]->get_data()));
+    EXPECT_EQ(0, *reinterpret_cast<uint64_t*>(frames[2]->get_data()));
+    EXPECT_EQ(hits + 1, buffer_manager.get_hit_count());
+    EXPECT_EQ(misses + 2, buffer_manager.get_miss_count());
+    for (auto* frame : frames) {
+        ++*reinterpret_cast<uint64_t*>(frame->get_data());
+    }
+    buffer_manager.unfix_pages(frames, true);
+    auto& page = buffer_manager.fix_page(segment | 5, false);
+    EXPECT_EQ(2, *reinterpret_cast<const uint64_t*>(page.get_data()));
+    buffer_manager.unfix_page(page, false);
+
+    // a batch that does not fit leaves nothing fixed
+    std::vector<uint64_t> too_many;
+    for (uint64_t page_id = 0; page_id < 40; ++page_id) {
+        too_many.push_back(segment | page_id);
+    }
+    misses = buffer_manager.get_miss_count();
+    EXPECT_THROW(buffer_manager.fix_pages(too_many, moderndbs::AccessMode::Shared), moderndbs::buffer_full_error);
+    // the frames it got were given back without reading their pages
+    EXPECT_EQ(misses, buffer_manager.get_miss_count());
+    for (uint64_t page_id = 0; page_id < 40; ++page_id) {
+        auto& page = buffer_manager.fix_page(segment | page_id, true);
+        buffer_manager.unfix_page(page, false);
+    }
+
+    // overlapping exclusive batches of several threads do not deadlock
+    std::vector<std::thread> threads;
+    for (uint64_t thread = 0; thread < 4; ++thread) {
+        threads.emplace_back([&, thread] {
+            std::vector<uint64_t> batch;
+            for (uint64_t i = 0; i < 4; ++i) {
+                batch.push_back(segment | (thread * 5 + i * 7) % 12);
+            }
+            for (size_t round = 0; round < 100; ++round) {
+                auto frames = buffer_manager.fix_pages(batch, moderndbs::AccessMode::Exclusive);
+                for (auto* frame : frames) {
+                    ++*reinterpret_cast<uint64_t*>(frame->get_data());
+                }
+                buffer_manager.unfix_pages(frames, true);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+
+// NOLINTNEXTLINE
+TEST(BufferManagerTest, PartitionedPersistentRestart) {
+    moderndbs::BufferManagerOptions options;
+    options.partition_count = 4;
+    auto buffer_manager = std::make_unique<moderndbs::BufferManager>(1024, 10, options);
+    for (uint64_t page_id = 0; page_id < 100; ++page_id) {
+        auto& page = buffer_manager->fix_page(page_id, true);
+        ASSERT_TRUE(page.get_data());
+        *reinterpret_cast<uint64_t*>(page.get_data()) = page_id * 3;
+        buffer_manager->unfix_page(page, true);
+        EXPECT_LE(buffer_manager->get_fifo_list().size() + buffer_manager->get_lru_list().size(), 10);
+    }
+    buffer_manager = std::make_unique<moderndbs::BufferManager>(1024, 10, options);
+    for (uint64_t page_id = 0; page_id < 100; ++page_id) {
+        auto& page = buffer_manager->fix_page(page_id, false);
+        uint64_t value = *reinterpret_cast<uint64_t*>(page.get_data());
+        buffer_manager->unfix_page(page, false);
+        EXPECT_EQ(page_id * 3, value);
+    }
+}
+
+
+// NOLINTNEXTLINE
+TEST(BufferManagerTest, OptimisticValidate) {
+    moderndbs::BufferManager buffer_manager{1024, 10};
+    auto& page = buffer_manager.fix_page(1, moderndbs::AccessMode::Optimistic);
+    // optimistic fixes are no references, the page stays in the FIFO list
+    auto& again = buffer_manager.fix_page(1, moderndbs::AccessMode::Optimistic);
+    buffer_manager.unfix_optimistic(again);
+    EXPECT_EQ(std::vector<uint64_t>{1}, buffer_manager.get_fifo_list());
+    auto version = page.read_version();
+    EXPECT_TRUE(page.validate(version));
+    {
+        auto& shared_page = buffer_manager.fix_page(1, false);
+        buffer_manager.unfix_page(shared_page, false);
+    }
+    EXPECT_TRUE(page.validate(version));
+    {
+        auto& exclusive_page = buffer_manager.fix_page(1, true);
+        EXPECT_FALSE(page.validate(version));
+        buffer_manager.unfix_page(exclusive_page, true);
+    }
+    EXPECT_FALSE(page.validate(version));
+    EXPECT_TRUE(page.validate(page.read_version()));
+    buffer_manager.unfix_optimistic(page);
+}
+
+
+// NOLINTNEXTLINE
+TEST(BufferManagerTest, OptimisticReadEviction) {
+    moderndbs::BufferManager buffer_manager{1024, 1};
+    {
+        auto& page = buffer_manager.fix_page(1, true);
+        *reinterpret_cast<uint64_t*>(page.get_data()) = 42;
+        buffer_manager.unfix_page(page, true);
+    }
+    size_t calls = 0;
+    auto value = buffer_manager.read_optimistic(1, [&](const char* data) {
+        if (calls++ == 0) {
+            // the page is not fixed by the read, so it can be evicted
+            auto& other = buffer_manager.fix_page(2, true);
+            *reinterpret_cast<uint64_t*>(other.get_data()) = 7;
+            buffer_manager.unfix_page(other, true);
+        }
+        return *reinterpret_cast<const uint64_t*>(data);
+    });
+    EXPECT_EQ(42, value);
+    EXPECT_EQ(2, calls);
+}
+
+
+// NOLINTNEXTLINE
+TEST(BufferManagerTest, PageCleanerWritesAhead) {
+    moderndbs::BufferManagerOptions options;
+    options.target_clean_ratio = 0.5;
+    options.cleaner_interval = std::chrono::milliseconds{1};
+    moderndbs::BufferManager buffer_manager{1024, 10, options};
+    // Segment 7 is only used by this test, the values differ between runs.
+    uint64_t segment_shift = static_cast<uint64_t>(7) << 48;
+    uint64_t base = std::random_device{}();
+    for (uint64_t segment_page = 0; segment_page < 10; ++segment_page) {
+        auto& page = buffer_manager.fix_page(segment_shift | segment_page, true);
+        *reinterpret_cast<uint64_t*>(page.get_data()) = base + segment_page;
+        buffer_manager.unfix_page(page, true);
+    }
+    // The first five pages in FIFO order are the next victims and are
+    // written by the cleaner while the buffer manager is still alive.
+    auto file = moderndbs::File::open_file("7", moderndbs::File::READ);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{10};
+    for (uint64_t segment_page = 0; segment_page < 5; ++segment_page) {
+        uint64_t value = 0;
+        while (value != base + segment_page && std::chrono::steady_clock::now() < deadline) {
+            file->read_block(segment_page * 1024, sizeof(value), reinterpret_cast<char*>(&value));
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        }
+        EXPECT_EQ(base + segment_page, value);
+    }
+}
+
+
+// NOLINTNEXTLINE
+TEST(BufferManagerTest, SegmentFileCache) {
+    moderndbs::SegmentFileCache cache{1};
+    auto file = cache.get(8);
+    EXPECT_EQ(file, cache.get(8));
+    // Opening another segment closes segment 8 in the cache, but the file
+    // stays usable for its current user.
+    auto other_file = cache.get(9);
+    EXPECT_NE(file, cache.get(8));
+    uint64_t value = 42;
+    file->write_block(reinterpret_cast<char*>(&value), 0, sizeof(value));
+    value = 0;
+    cache.get(8)->read_block(0, sizeof(value), reinterpret_cast<char*>(&value));
+    EXPECT_EQ(42, value);
+}
+
+
+// NOLINTNEXTLINE
+TEST(BufferManagerTest, Prefetch) {
+    uint64_t segment_shift = static_cast<uint64_t>(5) << 48;
+    {
+        moderndbs::BufferManager buffer_manager{1024, 10};
+        for (uint64_t segment_page = 0; segment_page < 8; ++segment_page) {
+            auto& page = buffer_manager.fix_page(segment_shift | segment_page, true);
+            *reinterpret_cast<uint64_t*>(page.get_data()) = segment_page + 1;
+            buffer_manager.unfix_page(page, true);
+        }
+    }
+    moderndbs::BufferManager buffer_manager{1024, 10};
+    std::vector<uint64_t> page_ids;
+    for (uint64_t segment_page = 0; segment_page < 8; ++segment_page) {
+        page_ids.push_back(segment_shift | segment_page);
+    }
+    buffer_manager.prefetch(page_ids);
+    // Prefetched pages are resident but not fixed.
+    EXPECT_EQ(page_ids, buffer_manager.get_fifo_list());
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < 4; ++i) {
+        threads.emplace_back([&buffer_manager, &page_ids] {
+            for (uint64_t segment_page = 0; segment_page < 8; ++segment_page) {
+                auto& page = buffer_manager.fix_page(page_ids[segment_page], false);
+                EXPECT_EQ(segment_page + 1, *reinterpret_cast<uint64_t*>(page.get_data()));
+                buffer_manager.unfix_page(page, false);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    // Prefetching resident pages does nothing.
+    buffer_manager.prefetch(page_ids);
+    EXPECT_EQ(8, buffer_manager.get_fifo_list().size() + buffer_manager.get_lru_list().size());
+}
+
+
+// NOLINTNEXTLINE
+TEST(BufferManagerTest, DirectIOFlushAll) {
+    moderndbs::BufferManagerOptions options;
+    options.io_mode = moderndbs::File::DIRECT;
+    uint64_t segment_shift = static_cast<uint64_t>(6) << 48;
+    uint64_t base = std::random_device{}();
+    moderndbs::BufferManager buffer_manager{4096, 4, options};
+    for (uint64_t segment_page = 0; segment_page < 8; ++segment_page) {
+        auto& page = buffer_manager.fix_page(segment_shift | segment_page, true);
+        reinterpret_cast<uint64_t*>(page.get_data())[1] = base + segment_page;
+        buffer_manager.unfix_page(page, true);
+    }
+    // The last four pages are only in memory until they are flushed.
+    buffer_manager.flush_all();
+    auto file = moderndbs::File::open_file("6", moderndbs::File::READ);
+    for (uint64_t segment_page = 0; segment_page < 8; ++segment_page) {
+        uint64_t value = 0;
+        file->read_block(segment_page * 4096 + sizeof(value), sizeof(value), reinterpret_cast<char*>(&value));
+        EXPECT_EQ(base + segment_page, value);
+    }
+    for (uint64_t segment_page = 4; segment_page < 8; ++segment_page) {
+        auto& page = buffer_manager.fix_page(segment_shift | segment_page, false);
+        EXPECT_EQ(base + segment_page, reinterpret_cast<uint64_t*>(page.get_data())[1]);
+        buffer_manager.unfix_page(page, false);
+    }
+}
+
+
 // NOLINTNEXTLINE
 TEST(BufferManagerTest, MultithreadParallelFix) {
     moderndbs::BufferManager buffer_manager{1024, 10};
@@ -190,8 +1191,8 @@ TEST(BufferManagerTest, MultithreadExclusiveAccess) {
     for (auto& thread : threads) {
         thread.join();
     }
-    EXPECT_TRUE(buffer_manager.get_fifo_list().empty());
-    EXPECT_EQ(std::vector<uint64_t>{0}, buffer_manager.get_lru_list());
+    EXPECT_EQ(std::vector<uint64_t>{0}, buffer_manager.get_fifo_list());
+    EXPECT_TRUE(buffer_manager.get_lru_list().empty());
     auto& page = buffer_manager.fix_page(0, false);
     ASSERT_TRUE(page.get_data());
     uint64_t value = *reinterpret_cast<uint64_t*>(page.get_data());
@@ -199,6 +1200,52 @@ TEST(BufferManagerTest, MultithreadExclusiveAccess) {
     EXPECT_EQ(4000, value);
 }
 
+// NOLINTNEXTLINE
+TEST(BufferManagerTest, MultithreadOptimisticRead) {
+    moderndbs::BufferManager buffer_manager{1024, 10};
+    {
+        auto& page = buffer_manager.fix_page(0, true);
+        std::memset(page.get_data(), 0, 1024);
+        buffer_manager.unfix_page(page, true);
+    }
+    std::atomic<bool> done = false;
+    // The writer keeps both halves of the first 16 bytes equal.
+    std::thread writer([&] {
+        for (uint64_t i = 1; i <= 2000; ++i) {
+            auto& page = buffer_manager.fix_page(0, true);
+            auto* values = reinterpret_cast<uint64_t*>(page.get_data());
+            values[0] = i;
+            std::this_thread::yield();
+            values[1] = i;
+            buffer_manager.unfix_page(page, true);
+        }
+        done = true;
+    });
+    std::vector<std::thread> readers;
+    for (size_t i = 0; i < 3; ++i) {
+        readers.emplace_back([&] {
+            uint64_t last = 0;
+            while (!done) {
+                auto [first, second] = buffer_manager.read_optimistic(0, [](const char* data) {
+                    uint64_t values[2];
+                    std::memcpy(values, data, sizeof(values));
+                    return std::make_pair(values[0], values[1]);
+                });
+                ASSERT_EQ(first, second);
+                ASSERT_GE(first, last);
+                last = first;
+            }
+        });
+    }
+    writer.join();
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    EXPECT_EQ(2000, buffer_manager.read_optimistic(0, [](const char* data) {
+        return *reinterpret_cast<const uint64_t*>(data);
+    }));
+}
+
 // NOLINTNEXTLINE
 TEST(BufferManagerTest, BlockedThreadsHoldsNoLocks) {
   moderndbs::BufferManager buffer_manager{1024, 10};
@@ -454,4 +1501,188 @@ TEST(BufferManagerTest, MultithreadReaderWriter) {
     EXPECT_LT(aborts.load(), 20);
 }
 
+
+// NOLINTNEXTLINE
+TEST(BufferManagerTest, EvictionWriteFailure) {
+    const uint64_t segment = uint64_t{29} << 48;
+    const uint64_t other_segment = uint64_t{30} << 48;
+    std::filesystem::remove_all("29");
+    moderndbs::BufferManagerOptions options;
+    // every write opens the segment file again
+    options.max_open_files = 0;
+    moderndbs::BufferManager buffer_manager{1024, 1, options};
+    auto& page = buffer_manager.fix_page(segment | 1, true);
+    *reinterpret_cast<uint64_t*>(page.get_data()) = 42;
+    buffer_manager.unfix_page(page, true);
+
+    // a directory in place of the segment file makes the write back fail
+    std::filesystem::remove("29");
+    std::filesystem::create_directory("29");
+    EXPECT_THROW(buffer_manager.fix_page(other_segment | 1, false), std::system_error);
+    std::vector<uint64_t> page_ids{other_segment | 1};
+    EXPECT_THROW(buffer_manager.fix_pages(page_ids, moderndbs::AccessMode::Shared), std::system_error);
+
+    // the page stays resident and dirty and can be fixed as usual
+    for (size_t round = 0; round < 2; ++round) {
+        auto& resident = buffer_manager.fix_page(segment | 1, round == 0);
+        EXPECT_EQ(42, *reinterpret_cast<const uint64_t*>(resident.get_data()));
+        buffer_manager.unfix_page(resident, false);
+    }
+    EXPECT_EQ(1, buffer_manager.stats().dirty_pages);
+
+    // once the segment can be written again, the page is evicted
+    std::filesystem::remove("29");
+    auto& other = buffer_manager.fix_page(other_segment | 1, false);
+    buffer_manager.unfix_page(other, false);
+    auto& reread = buffer_manager.fix_page(segment | 1, false);
+    EXPECT_EQ(42, *reinterpret_cast<const uint64_t*>(reread.get_data()));
+    buffer_manager.unfix_page(reread, false);
+}
+
+
+// NOLINTNEXTLINE
+TEST(BufferManagerTest, ReadAheadFailure) {
+    const uint64_t dirty_segment = uint64_t{34} << 48;
+    const uint64_t scan_segment = uint64_t{35} << 48;
+    const uint64_t other_segment = uint64_t{36} << 48;
+    std::filesystem::remove_all("34");
+    std::remove("35");
+    {
+        moderndbs::BufferManager buffer_manager{1024, 10};
+        for (uint64_t i = 0; i < 16; ++i) {
+            auto& page = buffer_manager.fix_page(scan_segment | i, true);
+            *reinterpret_cast<uint64_t*>(page.get_data()) = i;
+            buffer_manager.unfix_page(page, true);
+        }
+    }
+    moderndbs::BufferManagerOptions options;
+    options.max_open_files = 0;
+    options.max_read_ahead = 4;
+    moderndbs::BufferManager buffer_manager{1024, 5, options};
+    auto& dirty = buffer_manager.fix_page(dirty_segment | 1, true);
+    buffer_manager.unfix_page(dirty, true);
+    // the read-ahead has to evict the dirty page, whose write back fails
+    std::filesystem::remove("34");
+    std::filesystem::create_directory("34");
+    for (uint64_t i = 0; i < 4; ++i) {
+        auto& page = buffer_manager.fix_page(scan_segment | i, false);
+        EXPECT_EQ(i, *reinterpret_cast<const uint64_t*>(page.get_data()));
+        buffer_manager.unfix_page(page, false);
+    }
+
+    // no fix was leaked, every frame can be fixed at once
+    std::filesystem::remove("34");
+    std::vector<moderndbs::BufferFrame*> pages;
+    for (uint64_t i = 0; i < 5; ++i) {
+        pages.push_back(&buffer_manager.fix_page(other_segment | i, false));
+    }
+    for (auto* page : pages) {
+        buffer_manager.unfix_page(*page, false);
+    }
+    std::filesystem::remove("34");
+    std::remove("35");
+}
+
+
+// NOLINTNEXTLINE
+TEST(BufferManagerTest, ReadFailure) {
+    const uint64_t segment = uint64_t{32} << 48;
+    std::filesystem::remove_all("32");
+    {
+        moderndbs::BufferManager buffer_manager{1024, 2};
+        auto& page = buffer_manager.fix_page(segment | 1, true);
+        *reinterpret_cast<uint64_t*>(page.get_data()) = 42;
+        buffer_manager.unfix_page(page, true);
+    }
+    moderndbs::BufferManagerOptions options;
+    options.max_open_files = 0;
+    moderndbs::BufferManager buffer_manager{1024, 2, options};
+    // a directory in place of the segment file makes the read fail
+    std::filesystem::rename("32", "32.saved");
+    std::filesystem::create_directory("32");
+    EXPECT_THROW(buffer_manager.fix_page(segment | 1, false), std::system_error);
+    std::vector<uint64_t> page_ids{segment | 1};
+    EXPECT_THROW(buffer_manager.fix_pages(page_ids, moderndbs::AccessMode::Shared), std::system_error);
+    EXPECT_EQ(0, buffer_manager.stats().resident_pages);
+
+    // the page was not kept resident, so the next fix reads it again
+    std::filesystem::remove("32");
+    std::filesystem::rename("32.saved", "32");
+    auto& page = buffer_manager.fix_page(segment | 1, false);
+    EXPECT_EQ(42, *reinterpret_cast<const uint64_t*>(page.get_data()));
+    buffer_manager.unfix_page(page, false);
+}
+
+
+// NOLINTNEXTLINE
+TEST(BufferManagerTest, PrefetchOpenFailure) {
+    const uint64_t segment = uint64_t{38} << 48;
+    std::filesystem::remove_all("38");
+    std::filesystem::create_directory("38");
+    {
+        moderndbs::BufferManager buffer_manager{1024, 1};
+        std::vector<uint64_t> page_ids{segment | 1};
+        // the segment file cannot be opened, no frame is taken for the page
+        EXPECT_THROW(buffer_manager.prefetch(page_ids), std::system_error);
+        EXPECT_EQ(0, buffer_manager.stats().resident_pages);
+        std::filesystem::remove("38");
+        auto& page = buffer_manager.fix_page(segment | 1, false);
+        buffer_manager.unfix_page(page, false);
+        // the destructor has no read to wait for
+    }
+    std::filesystem::remove("38");
+}
+
+
+// NOLINTNEXTLINE
+TEST(BufferManagerTest, MmapBufferManager) {
+    const uint64_t segment = uint64_t{27} << 48;
+    std::remove("27");
+    {
+        moderndbs::BufferManager buffer_manager{1024, 10};
+        for (uint64_t page_id = 0; page_id < 20; ++page_id) {
+            auto& page = buffer_manager.fix_page(segment | page_id, true);
+            *reinterpret_cast<uint64_t*>(page.get_data()) = page_id;
+            buffer_manager.unfix_page(page, true);
+        }
+    }
+    {
+        // the segment files are shared with the buffer pool, pages beyond
+        // the end of the file read as zeros
+        moderndbs::MmapBufferManager buffer_manager{1024, 10, 1 << 20};
+        for (uint64_t page_id = 0; page_id < 40; ++page_id) {
+            auto& page = buffer_manager.fix_page(segment | page_id, true);
+            auto& value = *reinterpret_cast<uint64_t*>(page.get_data());
+            EXPECT_EQ(page_id < 20 ? page_id : 0, value);
+            value = page_id * 2;
+            buffer_manager.unfix_page(page, true);
+        }
+        EXPECT_THROW(buffer_manager.fix_page(segment | 1024, false), std::out_of_range);
+
+        std::vector<std::thread> threads;
+        for (size_t thread = 0; thread < 4; ++thread) {
+            threads.emplace_back([&] {
+                for (uint64_t round = 0; round < 1000; ++round) {
+                    auto& page = buffer_manager.fix_page(segment | (round % 4), true);
+                    ++*reinterpret_cast<uint64_t*>(page.get_data());
+                    buffer_manager.unfix_page(page, true);
+                    auto& other = buffer_manager.fix_page(segment | (round % 4), false);
+                    EXPECT_NE(0, *reinterpret_cast<const uint64_t*>(other.get_data()));
+                    buffer_manager.unfix_page(other, false);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        buffer_manager.flush_all();
+    }
+    moderndbs::BufferManager buffer_manager{1024, 10};
+    for (uint64_t page_id = 0; page_id < 40; ++page_id) {
+        auto& page = buffer_manager.fix_page(segment | page_id, false);
+        EXPECT_EQ(page_id * 2 + (page_id < 4 ? 1000 : 0), *reinterpret_cast<const uint64_t*>(page.get_data()));
+        buffer_manager.unfix_page(page, false);
+    }
+}
+
 }  // namespace